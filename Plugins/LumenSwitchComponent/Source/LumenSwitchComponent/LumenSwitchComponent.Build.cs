@@ -38,6 +38,9 @@ public class LumenSwitchComponent : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"RHI",
+				"RenderCore",
+				"AssetRegistry",
                 "EnhancedInput",
 				// ... add private dependencies that you statically link with here ...	
 			}
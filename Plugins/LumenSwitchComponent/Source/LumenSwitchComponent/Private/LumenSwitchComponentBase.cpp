@@ -1,10 +1,22 @@
 // Copyright Herbert Mehlhose, Herb64, 2025
 
 #include "LumenSwitchComponentBase.h"
+#include "LumenSwitcherConsoleVariables.h"
 #include "Logging/StructuredLog.h"
 #include "Kismet/GameplayStatics.h"
-#include "GameFramework/Character.h"
 #include "Camera/CameraComponent.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/GameInstance.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/Engine.h"
+#include "SceneView.h"
+#include "LegacyScreenPercentageDriver.h"
+#include "DynamicResolutionState.h"
+#include "StereoRendering.h"
 // #include "Components/SphereComponent.h"
 #include "Components/BrushComponent.h"
 // #include "Components/PostProcessComponent.h"
@@ -17,11 +29,34 @@
 #include "Math/UnrealMathUtility.h"
 #include "Components/LineBatchComponent.h"
 #include "Curves/CurveLinearColor.h"
+#include "PipelineStateCache.h"
+#include "ShaderPipelineCache.h"
+#if WITH_EDITOR
+#include "ShaderCompiler.h"
+#endif
+#include "RHI.h"
+#include "RenderUtils.h"
+#include "Scalability.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
 
 
 DEFINE_LOG_CATEGORY_STATIC(LogLumenSwitcher, Log, All)
 
 
+namespace
+{
+	/** Nearest rank percentile, Samples must be sorted ascending */
+	float Percentile(const TArray<float>& Samples, float Percent)
+	{
+		if (Samples.Num() == 0) return 0.f;
+		const int32 Rank = FMath::CeilToInt32(Percent / 100.f * Samples.Num());
+		return Samples[FMath::Clamp(Rank - 1, 0, Samples.Num() - 1)];
+	}
+}
+
+
 ULumenSwitchComponentBase::ULumenSwitchComponentBase()
 {
 	PrimaryComponentTick.bCanEverTick = true;
@@ -39,41 +74,53 @@ void ULumenSwitchComponentBase::BeginPlay()
 {
 	Super::BeginPlay();
 
-	// We only should attach this to a character with a Camera Component
-	ACharacter* OwnerCharacter = Cast<ACharacter>(GetOwner());
-	if (OwnerCharacter)
+	// The owner needs a Camera Component, used for the overrides. Usually this is the player Character
+	AActor* Owner = GetOwner();
+	if (Owner)
 	{
-		PlayerCameraComponent = OwnerCharacter->FindComponentByClass<UCameraComponent>();
+		PlayerCameraComponent = Owner->FindComponentByClass<UCameraComponent>();
 		if (!PlayerCameraComponent)
 		{
-			UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No camera component found on the Owner Character", __FUNCTION__);
+			UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No camera component found on the Owner {1}", __FUNCTION__, Owner->GetName());
 		}
 	}
 	else
 	{
-		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: Cannot access owner Character. The component requires a Character Actor", __FUNCTION__);
+		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: Cannot access owner Actor. The component requires an Actor with Camera Component", __FUNCTION__);
 	}
 	
 	bIsOVerrideEnabled = bEnableAtStart;
-	MaxPPVolPrioInLevel = GetPostProcessVolumesInLevel(PPVolumesInLevel, true);
 
 	SetupEnhancedInput();
 
-	// Setting: Use Hardware Raytracing When Available
-	GetDefaultLumen_HardwareRayTracing();    
+	// Cached cvar handles, original values get restored at EndPlay
+	ConsoleVariables.Initialize();
 
-	FPostProcessSettings CurrentPPSettings;
-	GetCurrentPostProcessSettings(CurrentPPSettings);
-	PlayerCameraComponent->PostProcessSettings.bOverride_SceneColorTint = false;
-	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = bIsOVerrideEnabled;
-	PlayerCameraComponent->PostProcessSettings.ReflectionMethod = CurrentPPSettings.ReflectionMethod;
-	PlayerCameraComponent->PostProcessSettings.bOverride_DynamicGlobalIlluminationMethod = bIsOVerrideEnabled;
-	PlayerCameraComponent->PostProcessSettings.DynamicGlobalIlluminationMethod = CurrentPPSettings.DynamicGlobalIlluminationMethod;
+	// Volume scan, settings resolution and visualization are time sliced, see StepInitialization()
+	PPVolumesInLevel.Empty();
+	MaxPPVolPrioInLevel = 0.f;
+	InitPPVols.Empty();
+	InitPPVolNames.Empty();
+	InitCursor = 0;
+	InitPhase = ESwitcherInitPhase::ResolveSettings;
+}
 
-	if (bVisualizePPVolBounds)
+
+/** Give back everything that has been changed, so nothing leaks into the next PIE session */
+void ULumenSwitchComponentBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bMatrixActive)
+	{
+		CancelMatrixSweep();
+	}
+	if (bWarmUpActive)
 	{
-		VisualizePostprocessVolumesInLevel(-1.f);
+		RestoreRenderConfiguration();
+		bWarmUpActive = false;
 	}
+	ConsoleVariables.RestoreOriginalValues();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -81,6 +128,38 @@ void ULumenSwitchComponentBase::TickComponent(float DeltaTime, ELevelTick TickTy
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	if (InitPhase != ESwitcherInitPhase::Done)
+	{
+		StepInitialization();
+		if (InitPhase == ESwitcherInitPhase::Done)
+		{
+			// The matrix sweep has to wait for the warm-up, otherwise it measures compilation
+			bMatrixSweepPending = bRunMatrixSweepAtStart;
+			if (bWarmUpPipelineStates)
+			{
+				StartPipelineWarmUp();
+			}
+		}
+	}
+	else if (bWarmUpActive)
+	{
+		StepPipelineWarmUp();
+	}
+	else if (bMatrixActive)
+	{
+		StepMatrixSweep();
+	}
+	else if (bMatrixSweepPending)
+	{
+		bMatrixSweepPending = false;
+		StartMatrixSweep();
+	}
+
+	if (bEvaluateAllViews && IsInitialized())
+	{
+		EvaluateViews();
+	}
+
 	if (FPSRefreshRate == 0.f) OnUpdateUI(DeltaTime);
 	FrameCount++;
 	AccuTime += DeltaTime;
@@ -92,8 +171,611 @@ void ULumenSwitchComponentBase::TickComponent(float DeltaTime, ELevelTick TickTy
 	}
 }
 
+/**
+ * Run initialization steps until the per frame budget is used up. At least one step is done per frame,
+ * so a budget smaller than a single step still makes progress. The UI gets partial results in between.
+ */
+void ULumenSwitchComponentBase::StepInitialization()
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = InitFrameBudget / 1000.0;
+	do
+	{
+		AdvanceInitialization();
+	} while (InitPhase != ESwitcherInitPhase::Done && FPlatformTime::Seconds() - StartTime < Budget);
+
+	OnInitializationProgress(GetInitializationProgress(), InitPhase == ESwitcherInitPhase::Done);
+}
+
+
+/**
+ * Single initialization step - either one CalcSceneView or one Post Process Volume in the current phase.
+ * The volumes are snapshotted as weak pointers once, so volumes getting destroyed in between are just skipped.
+ */
+void ULumenSwitchComponentBase::AdvanceInitialization()
+{
+	switch (InitPhase)
+	{
+	case ESwitcherInitPhase::ResolveSettings:
+	{
+		ResolveInitialSettings();
+		if (UWorld* World = GetWorld())
+		{
+			for (IInterface_PostProcessVolume* PPVolInterface : World->PostProcessVolumes)
+			{
+				if (APostProcessVolume* PPVol = Cast<APostProcessVolume>(PPVolInterface->_getUObject()))
+				{
+					InitPPVols.Add(PPVol);
+				}
+			}
+		}
+		InitCursor = 0;
+		InitPhase = ESwitcherInitPhase::DiscoverVolumes;
+		break;
+	}
+	case ESwitcherInitPhase::DiscoverVolumes:
+	{
+		if (!InitPPVols.IsValidIndex(InitCursor))
+		{
+			InitCursor = 0;
+			InitPhase = PlayerCameraComponent ? ESwitcherInitPhase::EvaluateEncompass : ESwitcherInitPhase::GenerateLines;
+			break;
+		}
+		FName DisplayName = NAME_None;
+		if (APostProcessVolume* PPVol = InitPPVols[InitCursor].Get())
+		{
+			DisplayName = FName(*PPVol->GetActorLabel());
+			FPostProcessVolumeInfo Info = MakePostProcessVolumeInfo(PPVol);
+			// Not yet evaluated, but infinite PP Volumes obviously contain the camera
+			Info.bCameraEncompassed = Info.bIsInfinte;
+			PPVolumesInLevel.Add(DisplayName, Info);
+			MaxPPVolPrioInLevel = FMath::Max(MaxPPVolPrioInLevel, Info.Priority);
+		}
+		InitPPVolNames.Add(DisplayName);
+		InitCursor++;
+		break;
+	}
+	case ESwitcherInitPhase::EvaluateEncompass:
+	{
+		if (!InitPPVols.IsValidIndex(InitCursor))
+		{
+			InitCursor = 0;
+			InitPhase = ESwitcherInitPhase::GenerateLines;
+			break;
+		}
+		APostProcessVolume* PPVol = InitPPVols[InitCursor].Get();
+		FPostProcessVolumeInfo* Info = PPVolumesInLevel.Find(InitPPVolNames[InitCursor]);
+		if (PPVol && Info && PlayerCameraComponent)
+		{
+			Info->bCameraEncompassed = IsCameraInside(PPVol) || Info->bIsInfinte;
+			UE_LOGFMT(LogLumenSwitcher, Display, "{0}: PPVol {1}, Inf={2}, Prio={3}, CamInside={4}", __FUNCTION__, InitPPVolNames[InitCursor], Info->bIsInfinte, Info->Priority, Info->bCameraEncompassed);
+		}
+		InitCursor++;
+		break;
+	}
+	case ESwitcherInitPhase::GenerateLines:
+	{
+		if (!bVisualizePPVolBounds || !InitPPVols.IsValidIndex(InitCursor))
+		{
+			InitPPVols.Empty();
+			InitPPVolNames.Empty();
+			InitCursor = 0;
+			InitPhase = ESwitcherInitPhase::Done;
+			break;
+		}
+		APostProcessVolume* PPVol = InitPPVols[InitCursor].Get();
+		FColor Color;
+		if (PPVol && !GetVisualizationColor(PPVol, Color))
+		{
+			// No usable color setup, skip the remaining volumes
+			InitCursor = InitPPVols.Num();
+			break;
+		}
+		if (PPVol)
+		{
+			VisualizePPVol(PPVol, Color, -1.f, VisualizationLineThickness);
+		}
+		InitCursor++;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+
+/** Take over the effective GI and Reflection Method at start into the Camera PP Settings */
+void ULumenSwitchComponentBase::ResolveInitialSettings()
+{
+	if (!PlayerCameraComponent) return;
+	FPostProcessSettings CurrentPPSettings;
+	GetCurrentPostProcessSettings(CurrentPPSettings);
+	PlayerCameraComponent->PostProcessSettings.bOverride_SceneColorTint = false;
+	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = bIsOVerrideEnabled;
+	PlayerCameraComponent->PostProcessSettings.ReflectionMethod = CurrentPPSettings.ReflectionMethod;
+	PlayerCameraComponent->PostProcessSettings.bOverride_DynamicGlobalIlluminationMethod = bIsOVerrideEnabled;
+	PlayerCameraComponent->PostProcessSettings.DynamicGlobalIlluminationMethod = CurrentPPSettings.DynamicGlobalIlluminationMethod;
+}
+
+
+bool ULumenSwitchComponentBase::IsInitialized() const
+{
+	return InitPhase == ESwitcherInitPhase::Done;
+}
+
+
+/** Each volume counts once per phase, the settings resolution counts as one additional step */
+float ULumenSwitchComponentBase::GetInitializationProgress() const
+{
+	const int32 NumVols = InitPPVols.Num();
+	const int32 NumPhases = bVisualizePPVolBounds ? 3 : 2;
+	const int32 Total = 1 + NumVols * NumPhases;
+	int32 Done = 0;
+	switch (InitPhase)
+	{
+	case ESwitcherInitPhase::ResolveSettings:
+		Done = 0;
+		break;
+	case ESwitcherInitPhase::DiscoverVolumes:
+		Done = 1 + InitCursor;
+		break;
+	case ESwitcherInitPhase::EvaluateEncompass:
+		Done = 1 + NumVols + InitCursor;
+		break;
+	case ESwitcherInitPhase::GenerateLines:
+		Done = 1 + NumVols * 2 + InitCursor;
+		break;
+	default:
+		return 1.f;
+	}
+	return FMath::Clamp(static_cast<float>(Done) / Total, 0.f, 1.f);
+}
+
+
+#pragma region PipelineWarmUp
+
+/**
+ * Pipeline states for a GI / Reflection path only get compiled when that path is rendered the first time, which
+ * causes a hitch on the first switch and spoils any comparison. So we render each configuration for a few frames
+ * and keep it until pending compiles are done. The warm-up is driven from TickComponent, one step per frame.
+ */
+void ULumenSwitchComponentBase::StartPipelineWarmUp()
+{
+	if (IsSwitchingLocked() || !IsInitialized()) return;
+	if (!PlayerCameraComponent)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No camera component, cannot warm up pipeline states", __FUNCTION__);
+		return;
+	}
+
+	SaveRenderConfiguration();
+	GetSwitchableConfigurations(WarmUpConfigurations);
+	WarmUpIndex = 0;
+	WarmUpFramesHeld = 0;
+	WarmUpStartTime = FPlatformTime::Seconds();
+	bWarmUpActive = true;
+	UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Warming up {1} configurations", __FUNCTION__, WarmUpConfigurations.Num());
+}
+
+
+bool ULumenSwitchComponentBase::IsWarmingUp() const
+{
+	return bWarmUpActive;
+}
+
+
+void ULumenSwitchComponentBase::GetSwitchableConfigurations(TArray<FSwitcherRenderConfiguration>& OutConfigurations) const
+{
+	static const EDynamicGlobalIlluminationMethod::Type GIMethods[] = {
+		EDynamicGlobalIlluminationMethod::None, EDynamicGlobalIlluminationMethod::Lumen, EDynamicGlobalIlluminationMethod::ScreenSpace };
+	static const EReflectionMethod::Type ReflectionMethods[] = {
+		EReflectionMethod::None, EReflectionMethod::Lumen, EReflectionMethod::ScreenSpace };
+
+	// Without ray tracing support on this RHI / GPU, HWRT silently falls back to software tracing
+	const bool bRayTracingEnabled = IsRayTracingEnabled();
+	OutConfigurations.Empty(UE_ARRAY_COUNT(GIMethods) * UE_ARRAY_COUNT(ReflectionMethods) * (bRayTracingEnabled ? 2 : 1));
+	for (bool bHWRT : { false, true })
+	{
+		if (bHWRT && !bRayTracingEnabled) break;
+		for (EDynamicGlobalIlluminationMethod::Type GIMethod : GIMethods)
+		{
+			for (EReflectionMethod::Type ReflectionMethod : ReflectionMethods)
+			{
+				// HWRT only has an effect if Lumen is used for GI or Reflections
+				if (bHWRT && GIMethod != EDynamicGlobalIlluminationMethod::Lumen && ReflectionMethod != EReflectionMethod::Lumen) continue;
+				FSwitcherRenderConfiguration& Configuration = OutConfigurations.AddDefaulted_GetRef();
+				Configuration.GlobalIlluminationMethod = GIMethod;
+				Configuration.ReflectionMethod = ReflectionMethod;
+				Configuration.bHardwareRayTracing = bHWRT;
+			}
+		}
+	}
+}
+
+
+/**
+ * A configuration is kept for at least WarmUpFramesPerConfiguration frames and then as long as compiles are
+ * pending. Frames are counted after the switch, so the first frame actually rendering the new path is included.
+ */
+void ULumenSwitchComponentBase::StepPipelineWarmUp()
+{
+	if (FPlatformTime::Seconds() - WarmUpStartTime > WarmUpTimeout)
+	{
+		FinishPipelineWarmUp(true);
+		return;
+	}
+	if (!WarmUpConfigurations.IsValidIndex(WarmUpIndex))
+	{
+		// All configurations cycled, settings restored - wait for the remaining compiles
+		if (GetNumPendingPipelineCompiles() == 0)
+		{
+			FinishPipelineWarmUp(false);
+		}
+		return;
+	}
+	if (WarmUpFramesHeld == 0)
+	{
+		ApplyRenderConfiguration(WarmUpConfigurations[WarmUpIndex]);
+	}
+	WarmUpFramesHeld++;
+	if (WarmUpFramesHeld > WarmUpFramesPerConfiguration && GetNumPendingPipelineCompiles() == 0)
+	{
+		WarmUpFramesHeld = 0;
+		WarmUpIndex++;
+		if (!WarmUpConfigurations.IsValidIndex(WarmUpIndex))
+		{
+			ApplyRenderConfiguration(SavedRenderConfiguration);
+		}
+	}
+}
+
+
+void ULumenSwitchComponentBase::FinishPipelineWarmUp(bool bTimedOut)
+{
+	RestoreRenderConfiguration();
+	bWarmUpActive = false;
+	WarmUpConfigurations.Empty();
+	const float Seconds = static_cast<float>(FPlatformTime::Seconds() - WarmUpStartTime);
+	if (bTimedOut)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Warm-up timed out after {1} s with {2} compiles still pending", __FUNCTION__, Seconds, GetNumPendingPipelineCompiles());
+	}
+	else
+	{
+		UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Warm-up finished after {1} s", __FUNCTION__, Seconds);
+	}
+	OnPipelineWarmUpFinished(Seconds, bTimedOut);
+}
+
+
+/** 
+ * Keep the camera overrides and HWRT state, so that warm-up and matrix sweep can restore them afterwards.
+ * Cvar changes queued by the user are dropped, they would otherwise be flushed by the first internal apply.
+ */
+void ULumenSwitchComponentBase::SaveRenderConfiguration()
+{
+	const int32 NumDropped = ConsoleVariables.ClearPending();
+	if (NumDropped > 0)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Dropped {1} queued cvar changes", __FUNCTION__, NumDropped);
+	}
+	if (!PlayerCameraComponent) return;
+	const FPostProcessSettings& CameraPPSettings = PlayerCameraComponent->PostProcessSettings;
+	bSavedOverrideGI = CameraPPSettings.bOverride_DynamicGlobalIlluminationMethod;
+	bSavedOverrideReflections = CameraPPSettings.bOverride_ReflectionMethod;
+	SavedRenderConfiguration.GlobalIlluminationMethod = CameraPPSettings.DynamicGlobalIlluminationMethod;
+	SavedRenderConfiguration.ReflectionMethod = CameraPPSettings.ReflectionMethod;
+	SavedRenderConfiguration.bHardwareRayTracing = ConsoleVariables.GetBool(ESwitcherCVar::LumenHardwareRayTracing);
+}
+
+
+void ULumenSwitchComponentBase::RestoreRenderConfiguration()
+{
+	if (!PlayerCameraComponent) return;
+	ApplyRenderConfiguration(SavedRenderConfiguration);
+	PlayerCameraComponent->PostProcessSettings.bOverride_DynamicGlobalIlluminationMethod = bSavedOverrideGI;
+	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = bSavedOverrideReflections;
+}
+
+
+/** Warm-up and matrix sweep own the settings while running, user toggles are ignored */
+bool ULumenSwitchComponentBase::IsSwitchingLocked() const
+{
+	return bWarmUpActive || bMatrixActive;
+}
+
+
+/** 
+ * Same override logic as the toggle functions, but setting an explicit combination.
+ * Cvar changes queued by warm-up or matrix sweep get applied in the same batch as the HWRT setting.
+ */
+void ULumenSwitchComponentBase::ApplyRenderConfiguration(const FSwitcherRenderConfiguration& Configuration)
+{
+	if (!PlayerCameraComponent) return;
+	PlayerCameraComponent->PostProcessSettings.bOverride_DynamicGlobalIlluminationMethod = true;
+	PlayerCameraComponent->PostProcessSettings.DynamicGlobalIlluminationMethod = Configuration.GlobalIlluminationMethod;
+	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = true;
+	PlayerCameraComponent->PostProcessSettings.ReflectionMethod = Configuration.ReflectionMethod;
+	ConsoleVariables.Queue(ESwitcherCVar::LumenHardwareRayTracing, Configuration.bHardwareRayTracing ? 1 : 0);
+	ConsoleVariables.ApplyPending();
+}
+
+
+/** 
+ * PSO precache requests and bundled pipeline cache precompiles. In the editor, shaders are compiled on demand
+ * by the shader compiling manager, so those jobs count as well.
+ */
+int32 ULumenSwitchComponentBase::GetNumPendingPipelineCompiles() const
+{
+	int32 Pending = PipelineStateCache::NumActivePrecacheRequests() + FShaderPipelineCache::NumPrecompilesRemaining();
+#if WITH_EDITOR
+	if (GShaderCompilingManager)
+	{
+		Pending += GShaderCompilingManager->GetNumRemainingJobs();
+	}
+#endif
+	return Pending;
+}
+
+#pragma endregion PipelineWarmUp
+
+
+#pragma region MatrixSweep
+
+/**
+ * Sweep scalability level, screen percentage and upscaler for each switchable GI / Reflection configuration.
+ * Cells are ordered with the configuration as outermost loop, so HWRT and GI path switches (the expensive
+ * ones) happen least often. Each cell settles for some frames before samples are taken, to keep the
+ * transition cost out of the percentiles. Runs after the warm-up if both are enabled.
+ */
+void ULumenSwitchComponentBase::StartMatrixSweep()
+{
+	if (IsSwitchingLocked() || !IsInitialized()) return;
+	if (!PlayerCameraComponent)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No camera component, cannot run matrix sweep", __FUNCTION__);
+		return;
+	}
+
+	TArray<FSwitcherRenderConfiguration> Configurations;
+	GetSwitchableConfigurations(Configurations);
+	MatrixCells.Empty();
+	for (const FSwitcherRenderConfiguration& Configuration : Configurations)
+	{
+		for (int32 ScalabilityLevel : MatrixScalabilityLevels)
+		{
+			for (float ScreenPercentage : MatrixScreenPercentages)
+			{
+				for (ESwitcherUpscalerMode UpscalerMode : MatrixUpscalerModes)
+				{
+					FSwitcherMatrixCell& Cell = MatrixCells.AddDefaulted_GetRef();
+					Cell.Configuration = Configuration;
+					Cell.ScalabilityLevel = ScalabilityLevel;
+					Cell.ScreenPercentage = ScreenPercentage;
+					Cell.UpscalerMode = UpscalerMode;
+				}
+			}
+		}
+	}
+	if (MatrixCells.Num() == 0)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: Empty matrix, check scalability levels, screen percentages and upscaler modes", __FUNCTION__);
+		return;
+	}
+
+	SaveRenderConfiguration();
+	SavedQualityLevels = Scalability::GetQualityLevels();
+	SavedAntiAliasingMethod = ConsoleVariables.GetInt(ESwitcherCVar::AntiAliasingMethod);
+	MatrixCellIndex = 0;
+	MatrixFrame = 0;
+	bMatrixCellApplied = false;
+	bMatrixCompilesDone = false;
+	MatrixLastStepTime = FPlatformTime::Seconds();
+	MatrixFrameTimes.Reset(MatrixSampleFrames);
+	MatrixGPUTimes.Reset(MatrixSampleFrames);
+	bMatrixActive = true;
+	UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Sweeping {1} cells", __FUNCTION__, MatrixCells.Num());
+}
+
+
+void ULumenSwitchComponentBase::CancelMatrixSweep()
+{
+	if (bMatrixActive)
+	{
+		FinishMatrixSweep(true);
+	}
+}
+
+
+bool ULumenSwitchComponentBase::IsMatrixSweepActive() const
+{
+	return bMatrixActive;
+}
+
+
+void ULumenSwitchComponentBase::GetMatrixResults(TArray<FSwitcherMatrixCell>& OutCells) const
+{
+	OutCells = MatrixCells;
+}
+
+
+/**
+ * Each cell goes through: apply, hold until pending compiles are done (new sg.* levels and AA modes bring in
+ * permutations the warm-up did not cover), settle, sample. Frame times are wall clock deltas between steps,
+ * the tick DeltaTime is dilated and clamped and therefore no measurement.
+ */
+void ULumenSwitchComponentBase::StepMatrixSweep()
+{
+	if (!MatrixCells.IsValidIndex(MatrixCellIndex))
+	{
+		FinishMatrixSweep(false);
+		return;
+	}
+	const double Now = FPlatformTime::Seconds();
+	const double FrameTime = Now - MatrixLastStepTime;
+	MatrixLastStepTime = Now;
+
+	FSwitcherMatrixCell& Cell = MatrixCells[MatrixCellIndex];
+	if (!bMatrixCellApplied)
+	{
+		ApplyMatrixCell(Cell);
+		bMatrixCellApplied = true;
+		bMatrixCompilesDone = false;
+		MatrixCellStartTime = Now;
+		return;
+	}
+	if (!bMatrixCompilesDone)
+	{
+		const int32 PendingCompiles = GetNumPendingPipelineCompiles();
+		if (PendingCompiles > 0)
+		{
+			if (Now - MatrixCellStartTime <= MatrixCompileTimeout) return;
+			UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Cell {1} still has {2} compiles pending after {3} s, sampling anyway", __FUNCTION__, MatrixCellIndex + 1, PendingCompiles, MatrixCompileTimeout);
+			Cell.bCompileTimedOut = true;
+		}
+		bMatrixCompilesDone = true;
+		MatrixFrame = 0;
+		return;
+	}
+	MatrixFrame++;
+	if (MatrixFrame > MatrixSettleFrames)
+	{
+		MatrixFrameTimes.Add(static_cast<float>(FrameTime * 1000.0));
+		MatrixGPUTimes.Add(FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles()));
+	}
+
+	if (MatrixFrameTimes.Num() >= MatrixSampleFrames)
+	{
+		MatrixFrameTimes.Sort();
+		MatrixGPUTimes.Sort();
+		Cell.SampleCount = MatrixFrameTimes.Num();
+		Cell.FrameTimeP50 = Percentile(MatrixFrameTimes, 50.f);
+		Cell.FrameTimeP90 = Percentile(MatrixFrameTimes, 90.f);
+		Cell.FrameTimeP99 = Percentile(MatrixFrameTimes, 99.f);
+		Cell.GPUTimeP50 = Percentile(MatrixGPUTimes, 50.f);
+		Cell.GPUTimeP90 = Percentile(MatrixGPUTimes, 90.f);
+		Cell.GPUTimeP99 = Percentile(MatrixGPUTimes, 99.f);
+		UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Cell {1}/{2} GI={3} Refl={4} HWRT={5} sg={6} SP={7} AA={8}: P50={9} P90={10} P99={11} ms, GPU P50={12} ms",
+			__FUNCTION__, MatrixCellIndex + 1, MatrixCells.Num(),
+			StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Cell.Configuration.GlobalIlluminationMethod),
+			StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Cell.Configuration.ReflectionMethod),
+			Cell.Configuration.bHardwareRayTracing, Cell.ScalabilityLevel, Cell.ScreenPercentage, UEnum::GetDisplayValueAsText(Cell.UpscalerMode).ToString(),
+			Cell.FrameTimeP50, Cell.FrameTimeP90, Cell.FrameTimeP99, Cell.GPUTimeP50);
+		OnMatrixCellMeasured(Cell);
+		MatrixFrameTimes.Reset();
+		MatrixGPUTimes.Reset();
+		MatrixFrame = 0;
+		bMatrixCellApplied = false;
+		MatrixCellIndex++;
+	}
+}
+
+
+/** 
+ * All scalability groups follow the single level, the screen percentage goes through sg.ResolutionQuality.
+ * sg.GlobalIlluminationQuality / sg.ReflectionQuality below High disable Lumen (Low also SSGI / SSR), and
+ * r.ScreenPercentage may be held at a higher priority, so the cell records what actually took effect.
+ */
+void ULumenSwitchComponentBase::ApplyMatrixCell(FSwitcherMatrixCell& Cell)
+{
+	Scalability::FQualityLevels QualityLevels = SavedQualityLevels;
+	QualityLevels.SetFromSingleQualityLevel(Cell.ScalabilityLevel);
+	QualityLevels.ResolutionQuality = Cell.ScreenPercentage;
+	Scalability::SetQualityLevels(QualityLevels, true);
+	ConsoleVariables.Queue(ESwitcherCVar::AntiAliasingMethod, static_cast<int32>(Cell.UpscalerMode));
+	ApplyRenderConfiguration(Cell.Configuration);
+
+	// Read back what took effect, the scalability ini and higher priority cvar sources can override the request
+	FSwitcherRenderConfiguration& Effective = Cell.EffectiveConfiguration;
+	Effective = Cell.Configuration;
+	if ((Effective.GlobalIlluminationMethod == EDynamicGlobalIlluminationMethod::Lumen && !ConsoleVariables.GetBool(ESwitcherCVar::LumenDiffuseIndirectAllow))
+		|| (Effective.GlobalIlluminationMethod == EDynamicGlobalIlluminationMethod::ScreenSpace && ConsoleVariables.GetInt(ESwitcherCVar::SSGIQuality) <= 0))
+	{
+		Effective.GlobalIlluminationMethod = EDynamicGlobalIlluminationMethod::None;
+	}
+	if ((Effective.ReflectionMethod == EReflectionMethod::Lumen && !ConsoleVariables.GetBool(ESwitcherCVar::LumenReflectionsAllow))
+		|| (Effective.ReflectionMethod == EReflectionMethod::ScreenSpace && ConsoleVariables.GetInt(ESwitcherCVar::SSRQuality) <= 0))
+	{
+		Effective.ReflectionMethod = EReflectionMethod::None;
+	}
+	Effective.bHardwareRayTracing = ConsoleVariables.GetBool(ESwitcherCVar::LumenHardwareRayTracing)
+		&& (Effective.GlobalIlluminationMethod == EDynamicGlobalIlluminationMethod::Lumen || Effective.ReflectionMethod == EReflectionMethod::Lumen);
+	Cell.EffectiveScreenPercentage = ConsoleVariables.GetFloat(ESwitcherCVar::ScreenPercentage);
+
+	Cell.bRequestedSettingsActive = Effective.GlobalIlluminationMethod == Cell.Configuration.GlobalIlluminationMethod
+		&& Effective.ReflectionMethod == Cell.Configuration.ReflectionMethod
+		&& Effective.bHardwareRayTracing == Cell.Configuration.bHardwareRayTracing
+		&& FMath::IsNearlyEqual(Cell.EffectiveScreenPercentage, Cell.ScreenPercentage);
+	if (!Cell.bRequestedSettingsActive)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Requested GI {1}, Reflections {2}, HWRT {3}, {4}% - in effect GI {5}, Reflections {6}, HWRT {7}, {8}% (r.ScreenPercentage set by {9})", __FUNCTION__,
+			StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Cell.Configuration.GlobalIlluminationMethod),
+			StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Cell.Configuration.ReflectionMethod),
+			Cell.Configuration.bHardwareRayTracing, Cell.ScreenPercentage,
+			StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Effective.GlobalIlluminationMethod),
+			StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Effective.ReflectionMethod),
+			Effective.bHardwareRayTracing, Cell.EffectiveScreenPercentage,
+			GetConsoleVariableSetByName(ConsoleVariables.GetSetBy(ESwitcherCVar::ScreenPercentage)));
+	}
+}
+
+
+void ULumenSwitchComponentBase::FinishMatrixSweep(bool bCancelled)
+{
+	Scalability::SetQualityLevels(SavedQualityLevels, true);
+	ConsoleVariables.Queue(ESwitcherCVar::AntiAliasingMethod, SavedAntiAliasingMethod);
+	RestoreRenderConfiguration();
+	bMatrixActive = false;
+	MatrixFrameTimes.Empty();
+	MatrixGPUTimes.Empty();
+	if (bCancelled)
+	{
+		UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Matrix sweep cancelled after {1} of {2} cells", __FUNCTION__, MatrixCellIndex, MatrixCells.Num());
+	}
+	else
+	{
+		WriteMatrixReport();
+	}
+	OnMatrixSweepFinished(bCancelled);
+}
+
+
+void ULumenSwitchComponentBase::WriteMatrixReport() const
+{
+	FString Report = TEXT("GIMethod,ReflectionMethod,HWRT,ScalabilityLevel,ScreenPercentage,Upscaler,")
+		TEXT("EffectiveGIMethod,EffectiveReflectionMethod,EffectiveHWRT,EffectiveScreenPercentage,RequestedActive,")
+		TEXT("Samples,CompileTimedOut,FrameP50,FrameP90,FrameP99,GPUP50,GPUP90,GPUP99\n");
+	for (const FSwitcherMatrixCell& Cell : MatrixCells)
+	{
+		Report += FString::Printf(TEXT("%s,%s,%d,%d,%.0f,%s,%s,%s,%d,%.0f,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+			*StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Cell.Configuration.GlobalIlluminationMethod),
+			*StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Cell.Configuration.ReflectionMethod),
+			Cell.Configuration.bHardwareRayTracing ? 1 : 0, Cell.ScalabilityLevel, Cell.ScreenPercentage,
+			*UEnum::GetDisplayValueAsText(Cell.UpscalerMode).ToString(),
+			*StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Cell.EffectiveConfiguration.GlobalIlluminationMethod),
+			*StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Cell.EffectiveConfiguration.ReflectionMethod),
+			Cell.EffectiveConfiguration.bHardwareRayTracing ? 1 : 0, Cell.EffectiveScreenPercentage, Cell.bRequestedSettingsActive ? 1 : 0,
+			Cell.SampleCount, Cell.bCompileTimedOut ? 1 : 0,
+			Cell.FrameTimeP50, Cell.FrameTimeP90, Cell.FrameTimeP99, Cell.GPUTimeP50, Cell.GPUTimeP90, Cell.GPUTimeP99);
+	}
+	const FString FileName = FPaths::ProjectSavedDir() / TEXT("LumenSwitcher") / FString::Printf(TEXT("Matrix_%s.csv"), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(Report, *FileName))
+	{
+		UE_LOGFMT(LogLumenSwitcher, Display, "{0}: Matrix report written to {1}", __FUNCTION__, FileName);
+	}
+	else
+	{
+		UE_LOGFMT(LogLumenSwitcher, Error, "{0}: Could not write matrix report {1}", __FUNCTION__, FileName);
+	}
+}
+
+
+#pragma endregion MatrixSweep
+
+
 bool ULumenSwitchComponentBase::ToggleOverrides()
 {
+	if (IsSwitchingLocked()) return bIsOVerrideEnabled;
 	bIsOVerrideEnabled = !bIsOVerrideEnabled;
 	if (PlayerCameraComponent)
 	{
@@ -121,6 +803,12 @@ bool ULumenSwitchComponentBase::IsOverrideEnabled() const
  */
 float ULumenSwitchComponentBase::GetPostProcessVolumesInLevel(TMap<FName, FPostProcessVolumeInfo>& PPVolMap, bool bDebug)
 {
+	// While initialization is running, only hand out the partial results collected so far
+	if (!IsInitialized())
+	{
+		PPVolMap.Append(PPVolumesInLevel);
+		return MaxPPVolPrioInLevel;
+	}
 	UWorld* World = GetWorld();
 	if (!World || !PlayerCameraComponent) return 0.f;
 	float Prio = 0.f;
@@ -133,10 +821,7 @@ float ULumenSwitchComponentBase::GetPostProcessVolumesInLevel(TMap<FName, FPostP
 		if (APostProcessVolume* PPVol = Cast<APostProcessVolume>(PPVolInterface->_getUObject()))
 		{
 			FName DisplayName = FName(*PPVol->GetActorLabel());
-			FPostProcessVolumeInfo Info = FPostProcessVolumeInfo();
-			Info.bIsInfinte = Properties.bIsUnbound;
-			Info.Priority = Properties.Priority;
-			Info.bIsEnabled = Properties.bIsEnabled;
+			FPostProcessVolumeInfo Info = MakePostProcessVolumeInfo(PPVol);
 			Prio = Info.Priority;
 			bool bEncompass = PPVolInterface->EncompassesPoint(PlayerCameraComponent->GetComponentLocation(), Properties.BlendRadius, &Distance);
 			// For infinite PP Volume - camera is inside the volume, obviously :)
@@ -161,6 +846,35 @@ float ULumenSwitchComponentBase::GetPostProcessVolumesInLevel(TMap<FName, FPostP
 	return Prio;
 }
 
+/**
+ * Shared between the component and the audit commandlet. Bounds are the brush component bounds without
+ * the blend radius, so the volume needs registered components (true for PIE and initialized worlds).
+ */
+FPostProcessVolumeInfo ULumenSwitchComponentBase::MakePostProcessVolumeInfo(const APostProcessVolume* PPVol)
+{
+	FPostProcessVolumeInfo Info = FPostProcessVolumeInfo();
+	if (!PPVol) return Info;
+	Info.bIsEnabled = PPVol->bEnabled;
+	Info.bIsInfinte = PPVol->bUnbound;
+	Info.Priority = PPVol->Priority;
+	Info.BlendRadius = PPVol->BlendRadius;
+	Info.BlendWeight = PPVol->BlendWeight;
+	if (!PPVol->bUnbound)
+	{
+		if (const UBrushComponent* BrushComp = PPVol->GetBrushComponent())
+		{
+			Info.Bounds = BrushComp->Bounds.GetBox();
+		}
+	}
+	const FPostProcessSettings& Settings = PPVol->Settings;
+	Info.bOverridesGlobalIllumination = Settings.bOverride_DynamicGlobalIlluminationMethod;
+	Info.GlobalIlluminationMethod = Settings.DynamicGlobalIlluminationMethod;
+	Info.bOverridesReflections = Settings.bOverride_ReflectionMethod;
+	Info.ReflectionMethod = Settings.ReflectionMethod;
+	return Info;
+}
+
+
 /**
  * This function is meant to be called when override of settings is enabled. 
  * This could be helpful to solve the Priority problem with Volumes that have lower priority
@@ -182,32 +896,24 @@ void ULumenSwitchComponentBase::DisableAllPostprocessVolumesInLevel()
 }
 
 
-void ULumenSwitchComponentBase::VisualizePostprocessVolumesInLevel(float LifeTime)
+/** Fixed color or priority based color relative to the highest priority found in level */
+bool ULumenSwitchComponentBase::GetVisualizationColor(const APostProcessVolume* PPVol, FColor& OutColor) const
 {
-	if (!bVisualizePPVolBounds) return;
-	UWorld* World = GetWorld();
-	if (!World) return;
-	TArray<IInterface_PostProcessVolume*> PPVolInterfaces = World->PostProcessVolumes;
-	for (IInterface_PostProcessVolume* PPVolInterface : PPVolInterfaces)
+	if (bColorizeByPriority)
 	{
-		if (APostProcessVolume* PPVol = Cast<APostProcessVolume>(PPVolInterface->_getUObject()))
+		if (!VisualizationColorCurve)
 		{
-			if (bColorizeByPriority)
-			{
-				if (!VisualizationColorCurve)
-				{
-					UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No Visualization Color Curve has been selected for Post Process Volumes... skipping", __FUNCTION__);
-					return;
-				}
-				float RelativePrio = MaxPPVolPrioInLevel < UE_SMALL_NUMBER ? 1.f : PPVol->Priority / MaxPPVolPrioInLevel;
-				VisualizePPVol(PPVol, VisualizationColorCurve->GetLinearColorValue(RelativePrio).ToFColor(true), LifeTime, VisualizationLineThickness);
-			}
-			else
-			{
-				VisualizePPVol(PPVol, VisualizationColor.ToFColor(true), LifeTime, VisualizationLineThickness);
-			}
+			UE_LOGFMT(LogLumenSwitcher, Error, "{0}: No Visualization Color Curve has been selected for Post Process Volumes... skipping", __FUNCTION__);
+			return false;
 		}
+		float RelativePrio = MaxPPVolPrioInLevel < UE_SMALL_NUMBER ? 1.f : PPVol->Priority / MaxPPVolPrioInLevel;
+		OutColor = VisualizationColorCurve->GetLinearColorValue(RelativePrio).ToFColor(true);
+	}
+	else
+	{
+		OutColor = VisualizationColor.ToFColor(true);
 	}
+	return true;
 }
 
 
@@ -394,7 +1100,7 @@ bool ULumenSwitchComponentBase::IsCameraInside(APostProcessVolume* PPVolume) con
  */
 void ULumenSwitchComponentBase::ToggleGlobalIlluminationMethod()
 {
-	if (!bIsOVerrideEnabled) return;
+	if (!bIsOVerrideEnabled || !PlayerCameraComponent || IsSwitchingLocked()) return;
 	FPostProcessSettings PPSettingsCurrent;
 	GetCurrentPostProcessSettings(PPSettingsCurrent);
 	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = true;
@@ -418,7 +1124,7 @@ void ULumenSwitchComponentBase::ToggleGlobalIlluminationMethod()
 
 void ULumenSwitchComponentBase::ToggleReflectionMethod()
 {
-	if (!bIsOVerrideEnabled) return;
+	if (!bIsOVerrideEnabled || !PlayerCameraComponent || IsSwitchingLocked()) return;
 	FPostProcessSettings PPSettingsCurrent;
 	GetCurrentPostProcessSettings(PPSettingsCurrent);
 	PlayerCameraComponent->PostProcessSettings.bOverride_ReflectionMethod = true;
@@ -441,7 +1147,7 @@ void ULumenSwitchComponentBase::ToggleReflectionMethod()
 
 
 /**
- * Get the effective Post Process Settings for the current View.
+ * Get the effective Post Process Settings for the current View of the owning Local Player, see EvaluateViews() for all views.
  * Source code for LocalPlayer.cpp and SceneView.cpp - lot of PP Stuff in here for learning.
  * If not starting in Selected Viewport, but New Editor Window PIE - SceneView null gets returned and 
  * causes crash. Simply skipping makes things magically work, although I'd have expected it
@@ -453,8 +1159,8 @@ void ULumenSwitchComponentBase::GetCurrentPostProcessSettings(FPostProcessSettin
 	UWorld* World = GetWorld();
 	if (World)
 	{
-		ULocalPlayer* LocalPlayer = World->GetFirstLocalPlayerFromController();
-		if (LocalPlayer)
+		ULocalPlayer* LocalPlayer = GetOwnerLocalPlayer();
+		if (LocalPlayer && LocalPlayer->ViewportClient)
 		{
 			FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
 				LocalPlayer->ViewportClient->Viewport,
@@ -477,6 +1183,206 @@ void ULumenSwitchComponentBase::GetCurrentPostProcessSettings(FPostProcessSettin
 }
 
 
+#pragma region MultiView
+
+/**
+ * Split-screen Local Players share the viewport, so all of them get calculated into a single view family, the
+ * same way the game viewport client does. Scene Captures have no scene view here - for those, the GI and
+ * Reflection Method are blended from the project defaults, the encompassing volumes and the capture settings,
+ * like World.cpp DoPostProcessVolume() does for the real views. The volume pass is shared by all views.
+ */
+void ULumenSwitchComponentBase::EvaluateViews()
+{
+	ViewInfos.Reset();
+	UWorld* World = GetWorld();
+	if (!World) return;
+
+	TArray<float> ViewPixels;
+	TArray<ULocalPlayer*> LocalPlayers;
+	if (UGameInstance* GameInstance = World->GetGameInstance())
+	{
+		LocalPlayers = GameInstance->GetLocalPlayers();
+	}
+	ULocalPlayer* FirstPlayer = LocalPlayers.Num() > 0 ? LocalPlayers[0] : nullptr;
+	if (FirstPlayer && FirstPlayer->ViewportClient && FirstPlayer->ViewportClient->Viewport)
+	{
+		FViewport* Viewport = FirstPlayer->ViewportClient->Viewport;
+		FSceneViewFamilyContext ViewFamily(FSceneViewFamily::ConstructionValues(
+			Viewport,
+			World->Scene,
+			FirstPlayer->ViewportClient->EngineShowFlags)
+			.SetRealtimeUpdate(true));
+		for (ULocalPlayer* LocalPlayer : LocalPlayers)
+		{
+			if (!LocalPlayer || !LocalPlayer->PlayerController) continue;
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			FSceneView* SceneView = LocalPlayer->CalcSceneView(&ViewFamily, ViewLocation, ViewRotation, Viewport);
+			if (!SceneView) continue;
+			FSwitcherViewInfo& ViewInfo = ViewInfos.AddDefaulted_GetRef();
+			ViewInfo.ViewName = FName(*LocalPlayer->GetName());
+			ViewInfo.ViewLocation = SceneView->ViewLocation;
+			ViewInfo.GlobalIlluminationMethod = SceneView->FinalPostProcessSettings.DynamicGlobalIlluminationMethod;
+			ViewInfo.ReflectionMethod = SceneView->FinalPostProcessSettings.ReflectionMethod;
+			ViewPixels.Add(static_cast<float>(SceneView->UnscaledViewRect.Area()));
+		}
+		// UnscaledViewRect is the output resolution, player views render internally at the resolution fraction
+		const float ResolutionFraction = GetPlayerResolutionFraction(ViewFamily);
+		for (float& Pixels : ViewPixels)
+		{
+			Pixels *= FMath::Square(ResolutionFraction);
+		}
+	}
+
+	const int32 FirstCapture = ViewInfos.Num();
+	TArray<USceneCaptureComponent2D*> Captures;
+	RegisteredSceneCaptures.RemoveAll([](const TWeakObjectPtr<USceneCaptureComponent2D>& Capture) { return !Capture.IsValid(); });
+	for (const TWeakObjectPtr<USceneCaptureComponent2D>& CapturePtr : RegisteredSceneCaptures)
+	{
+		USceneCaptureComponent2D* Capture = CapturePtr.Get();
+		// Manually driven captures (CaptureScene) are included as well, only a render target is required
+		if (!Capture->TextureTarget)
+		{
+			UE_LOGFMT(LogLumenSwitcher, Verbose, "{0}: Scene Capture {1} has no Texture Target, skipping", __FUNCTION__, Capture->GetName());
+			continue;
+		}
+		Captures.Add(Capture);
+		FSwitcherViewInfo& ViewInfo = ViewInfos.AddDefaulted_GetRef();
+		const AActor* CaptureOwner = Capture->GetOwner();
+		ViewInfo.ViewName = FName(*FString::Printf(TEXT("%s.%s"), CaptureOwner ? *CaptureOwner->GetActorLabel() : TEXT(""), *Capture->GetName()));
+		ViewInfo.bIsSceneCapture = true;
+		ViewInfo.ViewLocation = Capture->GetComponentLocation();
+		ViewInfo.GlobalIlluminationMethod = static_cast<EDynamicGlobalIlluminationMethod::Type>(ConsoleVariables.GetInt(ESwitcherCVar::DynamicGlobalIlluminationMethod));
+		ViewInfo.ReflectionMethod = static_cast<EReflectionMethod::Type>(ConsoleVariables.GetInt(ESwitcherCVar::ReflectionMethod));
+		ViewPixels.Add(static_cast<float>(Capture->TextureTarget->SizeX) * Capture->TextureTarget->SizeY);
+	}
+
+	// World->PostProcessVolumes is sorted in ascending priority, so later volumes win like in the engine
+	for (IInterface_PostProcessVolume* PPVolInterface : World->PostProcessVolumes)
+	{
+		FPostProcessVolumeProperties Properties = PPVolInterface->GetProperties();
+		if (!Properties.bIsEnabled) continue;
+		APostProcessVolume* PPVol = Cast<APostProcessVolume>(PPVolInterface->_getUObject());
+		for (int32 i = 0; i < ViewInfos.Num(); i++)
+		{
+			FSwitcherViewInfo& ViewInfo = ViewInfos[i];
+			float Distance = UE_BIG_NUMBER;
+			const bool bEncompass = Properties.bIsUnbound || PPVolInterface->EncompassesPoint(ViewInfo.ViewLocation, Properties.BlendRadius, &Distance);
+			if (!bEncompass) continue;
+			if (PPVol)
+			{
+				ViewInfo.EncompassingVolumes.Add(FName(*PPVol->GetActorLabel()));
+			}
+			if (i >= FirstCapture && Properties.BlendWeight > 0.f && Properties.Settings)
+			{
+				if (Properties.Settings->bOverride_DynamicGlobalIlluminationMethod)
+				{
+					ViewInfo.GlobalIlluminationMethod = Properties.Settings->DynamicGlobalIlluminationMethod;
+				}
+				if (Properties.Settings->bOverride_ReflectionMethod)
+				{
+					ViewInfo.ReflectionMethod = Properties.Settings->ReflectionMethod;
+				}
+			}
+		}
+	}
+
+	// Capture settings get applied last, as for the camera settings of a player view
+	for (int32 i = 0; i < Captures.Num(); i++)
+	{
+		const USceneCaptureComponent2D* Capture = Captures[i];
+		FSwitcherViewInfo& ViewInfo = ViewInfos[FirstCapture + i];
+		if (Capture->PostProcessBlendWeight <= 0.f) continue;
+		if (Capture->PostProcessSettings.bOverride_DynamicGlobalIlluminationMethod)
+		{
+			ViewInfo.GlobalIlluminationMethod = Capture->PostProcessSettings.DynamicGlobalIlluminationMethod;
+		}
+		if (Capture->PostProcessSettings.bOverride_ReflectionMethod)
+		{
+			ViewInfo.ReflectionMethod = Capture->PostProcessSettings.ReflectionMethod;
+		}
+	}
+
+	float TotalPixels = 0.f;
+	for (float Pixels : ViewPixels)
+	{
+		TotalPixels += Pixels;
+	}
+	for (int32 i = 0; i < ViewInfos.Num(); i++)
+	{
+		ViewInfos[i].FrameCostShare = TotalPixels > 0.f ? ViewPixels[i] / TotalPixels : 0.f;
+	}
+}
+
+
+void ULumenSwitchComponentBase::GetViewInfos(TArray<FSwitcherViewInfo>& OutViewInfos) const
+{
+	OutViewInfos = ViewInfos;
+}
+
+
+void ULumenSwitchComponentBase::RegisterSceneCapture(USceneCaptureComponent2D* SceneCapture)
+{
+	if (SceneCapture)
+	{
+		if (!SceneCapture->TextureTarget)
+		{
+			UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Scene Capture {1} has no Texture Target, it is skipped until one is set", __FUNCTION__, SceneCapture->GetName());
+		}
+		RegisteredSceneCaptures.AddUnique(SceneCapture);
+	}
+}
+
+
+void ULumenSwitchComponentBase::UnregisterSceneCapture(USceneCaptureComponent2D* SceneCapture)
+{
+	RegisteredSceneCaptures.Remove(SceneCapture);
+}
+
+#pragma endregion MultiView
+
+
+/**
+ * In split-screen, the owner Pawn belongs to one of several Local Players - its view is the one our camera
+ * overrides act on. Falls back to the first Local Player if the owner is not possessed by a local controller.
+ */
+/**
+ * Same resolution fraction the game viewport client uses: r.ScreenPercentage <= 0 leaves the choice to the
+ * r.ScreenPercentage.Default* settings, and dynamic resolution replaces the static fraction while it is enabled.
+ */
+float ULumenSwitchComponentBase::GetPlayerResolutionFraction(const FSceneViewFamily& ViewFamily) const
+{
+	FDynamicResolutionStateInfos DynamicResolutionInfos;
+	GEngine->GetDynamicResolutionCurrentStateInfos(DynamicResolutionInfos);
+	if (DynamicResolutionInfos.Status == EDynamicResolutionStatus::Enabled || DynamicResolutionInfos.Status == EDynamicResolutionStatus::DebugForceEnabled)
+	{
+		return DynamicResolutionInfos.ResolutionFractionApproximations[GDynamicPrimaryResolutionFraction];
+	}
+	FStaticResolutionFractionHeuristic StaticHeuristic(ViewFamily.EngineShowFlags);
+	StaticHeuristic.Settings.PullRunTimeRenderingSettings(GEngine->StereoRenderingDevice.IsValid() && GEngine->StereoRenderingDevice->IsStereoEnabled()
+		? EViewStatusForScreenPercentage::VR : EViewStatusForScreenPercentage::Desktop);
+	StaticHeuristic.PullViewFamilyRenderingSettings(ViewFamily);
+	return StaticHeuristic.ResolveResolutionFraction();
+}
+
+
+ULocalPlayer* ULumenSwitchComponentBase::GetOwnerLocalPlayer() const
+{
+	if (const APawn* OwnerPawn = Cast<APawn>(GetOwner()))
+	{
+		if (const APlayerController* PC = OwnerPawn->GetController<APlayerController>())
+		{
+			if (ULocalPlayer* LocalPlayer = PC->GetLocalPlayer())
+			{
+				return LocalPlayer;
+			}
+		}
+	}
+	UWorld* World = GetWorld();
+	return World ? World->GetFirstLocalPlayerFromController() : nullptr;
+}
+
+
 /**
  * This is actually not really used currently...
  * @TODO: maybe things could be done using the Camera PostProcess instead of having a component. Tests did fail, but should revisit this
@@ -492,35 +1398,72 @@ void ULumenSwitchComponentBase::GetCameraPostProcessSettings(FPostProcessSetting
 
 void ULumenSwitchComponentBase::SetupEnhancedInput()
 {
-	if (APlayerController* PC = UGameplayStatics::GetPlayerController(this, 0))
+	// Split-screen: each Switcher adds its mapping context to the Local Player owning it
+	if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(GetOwnerLocalPlayer()))
 	{
-		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PC->GetLocalPlayer()))
-		{
-			Subsystem->AddMappingContext(SwitcherInputMappingContext, 0);
-		}
+		Subsystem->AddMappingContext(SwitcherInputMappingContext, 0);
 	}
 }
 
 
 #pragma region ProjectSettings_Related
 
+/**
+ * The value at BeginPlay, from whatever source set it - project settings, device profile, command line...
+ * Reading GConfig directly did only see the project settings.
+ */
 bool ULumenSwitchComponentBase::GetDefaultLumen_HardwareRayTracing()
 {
-	GConfig->GetBool(TEXT("/Script/Engine.RendererSettings"), TEXT("r.Lumen.HardwareRayTracing"), bLumenUseHardwareRayTracing, GEngineIni);
-	return bLumenUseHardwareRayTracing;
+	return ConsoleVariables.GetOriginalInt(ESwitcherCVar::LumenHardwareRayTracing) != 0;
 }
 
 bool ULumenSwitchComponentBase::GetCurrentLumen_HardwareRayTracing()
 {
-	return bLumenUseHardwareRayTracing;
+	return ConsoleVariables.GetBool(ESwitcherCVar::LumenHardwareRayTracing);
 }
 
 bool ULumenSwitchComponentBase::ToggleLumenHardwareRayTracing()
 {
-	APlayerController* PC = UGameplayStatics::GetPlayerController(this, 0);
-	bLumenUseHardwareRayTracing = !bLumenUseHardwareRayTracing;
-	PC->ConsoleCommand(FString::Printf(TEXT("r.Lumen.HardwareRayTracing %d"), bLumenUseHardwareRayTracing), true);
-	return bLumenUseHardwareRayTracing;
+	if (!IsSwitchingLocked())
+	{
+		SetLumenHardwareRayTracing(!GetCurrentLumen_HardwareRayTracing());
+	}
+	return GetCurrentLumen_HardwareRayTracing();
+}
+
+void ULumenSwitchComponentBase::SetLumenHardwareRayTracing(bool bEnable)
+{
+	ConsoleVariables.Queue(ESwitcherCVar::LumenHardwareRayTracing, bEnable ? 1 : 0);
+	ConsoleVariables.ApplyPending();
+}
+
+int32 ULumenSwitchComponentBase::GetConsoleVariable(ESwitcherCVar Variable, FString& SetBy) const
+{
+	SetBy = GetConsoleVariableSetByName(ConsoleVariables.GetSetBy(Variable));
+	return ConsoleVariables.GetInt(Variable);
+}
+
+bool ULumenSwitchComponentBase::QueueConsoleVariable(ESwitcherCVar Variable, int32 Value)
+{
+	if (IsSwitchingLocked())
+	{
+		UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: {1} rejected, warm-up or matrix sweep is running", __FUNCTION__, FSwitcherConsoleVariables::GetName(Variable));
+		return false;
+	}
+	ConsoleVariables.Queue(Variable, Value);
+	return true;
+}
+
+bool ULumenSwitchComponentBase::ApplyConsoleVariables()
+{
+	if (IsSwitchingLocked())
+	{
+		const int32 NumDropped = ConsoleVariables.ClearPending();
+		UE_LOGFMT(LogLumenSwitcher, Warning, "{0}: Rejected, warm-up or matrix sweep is running - dropped {1} queued changes", __FUNCTION__, NumDropped);
+		return false;
+	}
+	ConsoleVariables.ApplyPending();
+	return true;
 }
 
 #pragma endregion ProjectSettings_Related
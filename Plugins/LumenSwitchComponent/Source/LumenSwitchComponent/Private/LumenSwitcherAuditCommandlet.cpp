@@ -0,0 +1,310 @@
+// Copyright Herbert Mehlhose, Herb64, 2025
+
+#include "LumenSwitcherAuditCommandlet.h"
+#include "LumenSwitchComponentBase.h"
+#include "Logging/StructuredLog.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/PostProcessVolume.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectHash.h"
+#include "UObject/UObjectGlobals.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogLumenSwitcherAudit, Log, All)
+
+
+namespace LumenSwitcherAudit
+{
+	/** Thresholds for flagging likely expensive overrides, engine defaults are 1 for the quality values */
+	constexpr float MaxQuality = 2.f;
+	constexpr float MaxSceneDetail = 2.f;
+	constexpr float MaxTraceDistance = 20000.f;
+	constexpr float MaxRoughnessToTrace = 0.4f;
+	constexpr int32 MaxReflectionBounces = 1;
+
+	struct FAuditEntry
+	{
+		FString Map;
+		FName Label;
+		FPostProcessVolumeInfo Info;
+		FPostProcessSettings Settings;
+		TArray<FString> Flags;
+	};
+
+	FString GIMethodName(EDynamicGlobalIlluminationMethod::Type Method)
+	{
+		return StaticEnum<EDynamicGlobalIlluminationMethod::Type>()->GetNameStringByValue(Method);
+	}
+
+	FString ReflectionMethodName(EReflectionMethod::Type Method)
+	{
+		return StaticEnum<EReflectionMethod::Type>()->GetNameStringByValue(Method);
+	}
+
+	/** Empty cell for values not overridden by the volume */
+	template<typename T>
+	FString OverrideValue(bool bOverride, T Value)
+	{
+		return bOverride ? LexToString(Value) : FString();
+	}
+
+	/** Volume contributes at all and overrides the GI or Reflection Method */
+	bool SetsRenderingPath(const FPostProcessVolumeInfo& Info)
+	{
+		return Info.bIsEnabled && Info.BlendWeight > 0.f && (Info.bOverridesGlobalIllumination || Info.bOverridesReflections);
+	}
+
+	/** Both volumes override the same method with different values - the winner depends on undefined order */
+	bool HasConflictingPath(const FPostProcessVolumeInfo& A, const FPostProcessVolumeInfo& B)
+	{
+		const bool bGIConflict = A.bOverridesGlobalIllumination && B.bOverridesGlobalIllumination && A.GlobalIlluminationMethod != B.GlobalIlluminationMethod;
+		const bool bReflectionConflict = A.bOverridesReflections && B.bOverridesReflections && A.ReflectionMethod != B.ReflectionMethod;
+		return bGIConflict || bReflectionConflict;
+	}
+
+	void FlagExpensiveSettings(FAuditEntry& Entry)
+	{
+		const FPostProcessVolumeInfo& Info = Entry.Info;
+		const FPostProcessSettings& S = Entry.Settings;
+		if (!Info.bIsEnabled || Info.BlendWeight <= 0.f)
+		{
+			Entry.Flags.Add(TEXT("NoEffect"));
+			return;
+		}
+		if (S.bOverride_LumenSceneLightingQuality && S.LumenSceneLightingQuality > MaxQuality) Entry.Flags.Add(TEXT("HighSceneLightingQuality"));
+		if (S.bOverride_LumenSceneDetail && S.LumenSceneDetail > MaxSceneDetail) Entry.Flags.Add(TEXT("HighSceneDetail"));
+		if (S.bOverride_LumenSceneViewDistance && S.LumenSceneViewDistance > MaxTraceDistance) Entry.Flags.Add(TEXT("LargeSceneViewDistance"));
+		if (S.bOverride_LumenFinalGatherQuality && S.LumenFinalGatherQuality > MaxQuality) Entry.Flags.Add(TEXT("HighFinalGatherQuality"));
+		if (S.bOverride_LumenMaxTraceDistance && S.LumenMaxTraceDistance > MaxTraceDistance) Entry.Flags.Add(TEXT("LargeMaxTraceDistance"));
+		if (S.bOverride_LumenReflectionQuality && S.LumenReflectionQuality > MaxQuality) Entry.Flags.Add(TEXT("HighReflectionQuality"));
+		if (S.bOverride_LumenMaxReflectionBounces && S.LumenMaxReflectionBounces > MaxReflectionBounces) Entry.Flags.Add(TEXT("MultipleReflectionBounces"));
+		if (S.bOverride_LumenMaxRoughnessToTraceReflections && S.LumenMaxRoughnessToTraceReflections > MaxRoughnessToTrace) Entry.Flags.Add(TEXT("HighRoughnessToTrace"));
+		if (S.bOverride_LumenRayLightingMode && S.LumenRayLightingMode == ELumenRayLightingModeOverride::HitLighting) Entry.Flags.Add(TEXT("HitLighting"));
+		if (S.bOverride_LumenFrontLayerTranslucencyReflections && S.LumenFrontLayerTranslucencyReflections) Entry.Flags.Add(TEXT("FrontLayerTranslucencyReflections"));
+		if (Info.bOverridesReflections && Info.ReflectionMethod == EReflectionMethod::Lumen
+			&& Info.bOverridesGlobalIllumination && Info.GlobalIlluminationMethod != EDynamicGlobalIlluminationMethod::Lumen)
+		{
+			Entry.Flags.Add(TEXT("LumenReflectionsWithoutLumenGI"));
+		}
+	}
+
+	/**
+	 * Pairwise check within one map. Unbound volumes of equal priority always overlap, bounded ones only if their
+	 * bounds expanded by the blend radius intersect. Maps usually have few volumes, so O(n^2) is fine.
+	 */
+	void FlagConflicts(TArrayView<FAuditEntry> MapEntries)
+	{
+		for (int32 i = 0; i < MapEntries.Num(); i++)
+		{
+			for (int32 j = i + 1; j < MapEntries.Num(); j++)
+			{
+				FAuditEntry& A = MapEntries[i];
+				FAuditEntry& B = MapEntries[j];
+				if (!SetsRenderingPath(A.Info) || !SetsRenderingPath(B.Info)) continue;
+				if (!FMath::IsNearlyEqual(A.Info.Priority, B.Info.Priority) || !HasConflictingPath(A.Info, B.Info)) continue;
+				bool bOverlap = A.Info.bIsInfinte || B.Info.bIsInfinte;
+				if (!bOverlap && A.Info.Bounds.IsValid && B.Info.Bounds.IsValid)
+				{
+					bOverlap = A.Info.Bounds.ExpandBy(A.Info.BlendRadius).Intersect(B.Info.Bounds.ExpandBy(B.Info.BlendRadius));
+				}
+				if (bOverlap)
+				{
+					A.Flags.Add(FString::Printf(TEXT("ConflictsWith:%s"), *B.Label.ToString()));
+					B.Flags.Add(FString::Printf(TEXT("ConflictsWith:%s"), *A.Label.ToString()));
+				}
+			}
+		}
+	}
+
+	/** Same kind of initialization as other map processing commandlets, just enough to register components */
+	void AuditWorld(UWorld* World, const FString& MapName, TArray<FAuditEntry>& OutEntries)
+	{
+		World->AddToRoot();
+		World->WorldType = EWorldType::Editor;
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(false)
+			.RequiresHitProxies(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(false)
+			.SetTransactional(false)
+			.CreateFXSystem(false));
+		World->UpdateWorldComponents(true, false);
+
+		if (World->IsPartitionedWorld())
+		{
+			UE_LOGFMT(LogLumenSwitcherAudit, Warning, "{0}: {1} is a World Partition map, only always loaded volumes are audited", __FUNCTION__, MapName);
+		}
+
+		const int32 FirstEntry = OutEntries.Num();
+		for (IInterface_PostProcessVolume* PPVolInterface : World->PostProcessVolumes)
+		{
+			if (APostProcessVolume* PPVol = Cast<APostProcessVolume>(PPVolInterface->_getUObject()))
+			{
+				FAuditEntry& Entry = OutEntries.AddDefaulted_GetRef();
+				Entry.Map = MapName;
+				Entry.Label = FName(*PPVol->GetActorLabel());
+				Entry.Info = ULumenSwitchComponentBase::MakePostProcessVolumeInfo(PPVol);
+				Entry.Settings = PPVol->Settings;
+				FlagExpensiveSettings(Entry);
+			}
+		}
+		FlagConflicts(TArrayView<FAuditEntry>(OutEntries.GetData() + FirstEntry, OutEntries.Num() - FirstEntry));
+
+		World->CleanupWorld();
+		World->RemoveFromRoot();
+	}
+
+	/** RFC 4180 quoting - vector strings and actor labels may contain commas, quotes or line breaks */
+	FString EscapeCsvCell(const FString& Cell)
+	{
+		if (!Cell.Contains(TEXT(",")) && !Cell.Contains(TEXT("\"")) && !Cell.Contains(TEXT("\n")) && !Cell.Contains(TEXT("\r")))
+		{
+			return Cell;
+		}
+		return FString::Printf(TEXT("\"%s\""), *Cell.Replace(TEXT("\""), TEXT("\"\"")));
+	}
+
+	FString MakeReport(const TArray<FAuditEntry>& Entries)
+	{
+		FString Report = TEXT("Map,Volume,Enabled,Unbound,Priority,BlendRadius,BlendWeight,BoundsMin,BoundsMax,GIMethod,ReflectionMethod,")
+			TEXT("SceneLightingQuality,SceneDetail,SceneViewDistance,FinalGatherQuality,MaxTraceDistance,ReflectionQuality,")
+			TEXT("MaxReflectionBounces,MaxRoughnessToTrace,RayLightingMode,FrontLayerTranslucencyReflections,Flags\n");
+		for (const FAuditEntry& Entry : Entries)
+		{
+			const FPostProcessVolumeInfo& Info = Entry.Info;
+			const FPostProcessSettings& S = Entry.Settings;
+			TArray<FString> Cells;
+			Cells.Add(Entry.Map);
+			Cells.Add(Entry.Label.ToString());
+			Cells.Add(LexToString(Info.bIsEnabled));
+			Cells.Add(LexToString(Info.bIsInfinte));
+			Cells.Add(LexToString(Info.Priority));
+			Cells.Add(LexToString(Info.BlendRadius));
+			Cells.Add(LexToString(Info.BlendWeight));
+			Cells.Add(Info.Bounds.IsValid ? Info.Bounds.Min.ToCompactString() : FString());
+			Cells.Add(Info.Bounds.IsValid ? Info.Bounds.Max.ToCompactString() : FString());
+			Cells.Add(Info.bOverridesGlobalIllumination ? GIMethodName(Info.GlobalIlluminationMethod) : FString());
+			Cells.Add(Info.bOverridesReflections ? ReflectionMethodName(Info.ReflectionMethod) : FString());
+			Cells.Add(OverrideValue(S.bOverride_LumenSceneLightingQuality, S.LumenSceneLightingQuality));
+			Cells.Add(OverrideValue(S.bOverride_LumenSceneDetail, S.LumenSceneDetail));
+			Cells.Add(OverrideValue(S.bOverride_LumenSceneViewDistance, S.LumenSceneViewDistance));
+			Cells.Add(OverrideValue(S.bOverride_LumenFinalGatherQuality, S.LumenFinalGatherQuality));
+			Cells.Add(OverrideValue(S.bOverride_LumenMaxTraceDistance, S.LumenMaxTraceDistance));
+			Cells.Add(OverrideValue(S.bOverride_LumenReflectionQuality, S.LumenReflectionQuality));
+			Cells.Add(OverrideValue(S.bOverride_LumenMaxReflectionBounces, S.LumenMaxReflectionBounces));
+			Cells.Add(OverrideValue(S.bOverride_LumenMaxRoughnessToTraceReflections, S.LumenMaxRoughnessToTraceReflections));
+			Cells.Add(OverrideValue(S.bOverride_LumenRayLightingMode, static_cast<int32>(S.LumenRayLightingMode)));
+			Cells.Add(OverrideValue(S.bOverride_LumenFrontLayerTranslucencyReflections, static_cast<bool>(S.LumenFrontLayerTranslucencyReflections)));
+			Cells.Add(FString::Join(Entry.Flags, TEXT(";")));
+			for (FString& Cell : Cells)
+			{
+				Cell = EscapeCsvCell(Cell);
+			}
+			Report += FString::Join(Cells, TEXT(",")) + TEXT("\n");
+		}
+		return Report;
+	}
+}
+
+
+ULumenSwitcherAuditCommandlet::ULumenSwitcherAuditCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+int32 ULumenSwitcherAuditCommandlet::Main(const FString& Params)
+{
+	using namespace LumenSwitcherAudit;
+
+	FString MapsRoot = TEXT("/Game");
+	FParse::Value(*Params, TEXT("Maps="), MapsRoot);
+	int32 BatchSize = 8;
+	FParse::Value(*Params, TEXT("BatchSize="), BatchSize);
+	BatchSize = FMath::Max(1, BatchSize);
+	FString OutputFile = FPaths::ProjectSavedDir() / TEXT("LumenSwitcher") / TEXT("PPVolumeAudit.csv");
+	FParse::Value(*Params, TEXT("Output="), OutputFile);
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+	FARFilter Filter;
+	Filter.ClassPaths.Add(UWorld::StaticClass()->GetClassPathName());
+	Filter.PackagePaths.Add(FName(*MapsRoot));
+	Filter.bRecursivePaths = true;
+	TArray<FAssetData> MapAssets;
+	AssetRegistry.GetAssets(Filter, MapAssets);
+	UE_LOGFMT(LogLumenSwitcherAudit, Display, "{0}: Auditing {1} maps below {2} in batches of {3}", __FUNCTION__, MapAssets.Num(), MapsRoot, BatchSize);
+
+	TArray<FAuditEntry> Entries;
+	int32 NumFailed = 0;
+	for (int32 BatchStart = 0; BatchStart < MapAssets.Num(); BatchStart += BatchSize)
+	{
+		const int32 BatchEnd = FMath::Min(BatchStart + BatchSize, MapAssets.Num());
+		for (int32 i = BatchStart; i < BatchEnd; i++)
+		{
+			LoadPackageAsync(MapAssets[i].PackageName.ToString());
+		}
+		FlushAsyncLoading();
+
+		for (int32 i = BatchStart; i < BatchEnd; i++)
+		{
+			const FString MapName = MapAssets[i].PackageName.ToString();
+			UPackage* Package = FindPackage(nullptr, *MapName);
+			UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+			if (World)
+			{
+				AuditWorld(World, MapName, Entries);
+			}
+			else
+			{
+				UE_LOGFMT(LogLumenSwitcherAudit, Error, "{0}: Failed to load {1}", __FUNCTION__, MapName);
+				NumFailed++;
+			}
+			if (Package)
+			{
+				// IsEditor commandlets keep RF_Standalone objects on GC, so the map assets would pile up otherwise
+				ForEachObjectWithPackage(Package, [](UObject* Object)
+				{
+					Object->ClearFlags(RF_Standalone);
+					return true;
+				});
+				ResetLoaders(Package);
+			}
+		}
+		CollectGarbage(RF_NoFlags);
+		UE_LOGFMT(LogLumenSwitcherAudit, Display, "{0}: {1}/{2} maps done", __FUNCTION__, BatchEnd, MapAssets.Num());
+	}
+
+	int32 NumFlagged = 0;
+	for (const FAuditEntry& Entry : Entries)
+	{
+		if (Entry.Flags.Num() > 0)
+		{
+			NumFlagged++;
+			UE_LOGFMT(LogLumenSwitcherAudit, Warning, "{0}: {1} {2}: {3}", __FUNCTION__, Entry.Map, Entry.Label, FString::Join(Entry.Flags, TEXT(", ")));
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(MakeReport(Entries), *OutputFile))
+	{
+		UE_LOGFMT(LogLumenSwitcherAudit, Error, "{0}: Could not write report {1}", __FUNCTION__, OutputFile);
+		return 1;
+	}
+	UE_LOGFMT(LogLumenSwitcherAudit, Display, "{0}: {1} volumes, {2} flagged, report written to {3}", __FUNCTION__, Entries.Num(), NumFlagged, OutputFile);
+	if (NumFailed > 0)
+	{
+		UE_LOGFMT(LogLumenSwitcherAudit, Error, "{0}: {1} of {2} maps failed to load", __FUNCTION__, NumFailed, MapAssets.Num());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,196 @@
+// Copyright Herbert Mehlhose, Herb64, 2025
+
+#include "LumenSwitcherConsoleVariables.h"
+#include "Logging/StructuredLog.h"
+
+
+DEFINE_LOG_CATEGORY_STATIC(LogLumenSwitcherCVars, Log, All)
+
+
+const TCHAR* FSwitcherConsoleVariables::GetName(ESwitcherCVar Variable)
+{
+	static const TCHAR* Names[] = {
+		TEXT("r.Lumen.HardwareRayTracing"),
+		TEXT("r.Lumen.HardwareRayTracing.LightingMode"),
+		TEXT("r.Lumen.DiffuseIndirect.Allow"),
+		TEXT("r.Lumen.Reflections.Allow"),
+		TEXT("r.RayTracing"),
+		TEXT("r.DynamicGlobalIlluminationMethod"),
+		TEXT("r.ReflectionMethod"),
+		TEXT("r.AntiAliasingMethod"),
+		TEXT("r.ScreenPercentage"),
+		TEXT("r.SSGI.Quality"),
+		TEXT("r.SSR.Quality")
+	};
+	static_assert(UE_ARRAY_COUNT(Names) == static_cast<int32>(ESwitcherCVar::Num), "Name table does not match ESwitcherCVar");
+	return Names[static_cast<int32>(Variable)];
+}
+
+
+namespace
+{
+	/** Original state of one cvar, shared by all Switcher instances */
+	struct FSnapshotEntry
+	{
+		FString OriginalValue;
+		EConsoleVariableFlags OriginalSetBy = ECVF_SetByConstructor;
+		bool bModified = false;
+		int32 LastAppliedValue = 0;
+	};
+
+	FSnapshotEntry GSnapshot[static_cast<int32>(ESwitcherCVar::Num)];
+	int32 GSnapshotRefCount = 0;
+}
+
+
+FSwitcherConsoleVariables::~FSwitcherConsoleVariables()
+{
+	// Components usually restore at EndPlay, this only keeps the ref count right if that did not happen
+	if (bHoldsSnapshot)
+	{
+		RestoreOriginalValues();
+	}
+}
+
+
+void FSwitcherConsoleVariables::Initialize()
+{
+	Pending.Reset();
+	if (bHoldsSnapshot) return;
+	const bool bTakeSnapshot = GSnapshotRefCount++ == 0;
+	bHoldsSnapshot = true;
+	for (int32 i = 0; i < static_cast<int32>(ESwitcherCVar::Num); i++)
+	{
+		IConsoleVariable*& Variable = Variables[i];
+		Variable = IConsoleManager::Get().FindConsoleVariable(GetName(static_cast<ESwitcherCVar>(i)));
+		if (!Variable)
+		{
+			UE_LOGFMT(LogLumenSwitcherCVars, Warning, "{0}: {1} not found", __FUNCTION__, GetName(static_cast<ESwitcherCVar>(i)));
+			continue;
+		}
+		if (bTakeSnapshot)
+		{
+			FSnapshotEntry& Entry = GSnapshot[i];
+			Entry = FSnapshotEntry();
+			Entry.OriginalValue = Variable->GetString();
+			Entry.OriginalSetBy = static_cast<EConsoleVariableFlags>(Variable->GetFlags() & ECVF_SetByMask);
+			UE_LOGFMT(LogLumenSwitcherCVars, Verbose, "{0}: {1}={2} ({3})", __FUNCTION__, GetName(static_cast<ESwitcherCVar>(i)), Entry.OriginalValue, GetConsoleVariableSetByName(Entry.OriginalSetBy));
+		}
+	}
+}
+
+
+int32 FSwitcherConsoleVariables::GetInt(ESwitcherCVar Variable) const
+{
+	const IConsoleVariable* CVar = Variables[static_cast<int32>(Variable)];
+	return CVar ? CVar->GetInt() : 0;
+}
+
+
+bool FSwitcherConsoleVariables::GetBool(ESwitcherCVar Variable) const
+{
+	return GetInt(Variable) != 0;
+}
+
+
+float FSwitcherConsoleVariables::GetFloat(ESwitcherCVar Variable) const
+{
+	const IConsoleVariable* CVar = Variables[static_cast<int32>(Variable)];
+	return CVar ? CVar->GetFloat() : 0.f;
+}
+
+
+int32 FSwitcherConsoleVariables::GetOriginalInt(ESwitcherCVar Variable) const
+{
+	return Variables[static_cast<int32>(Variable)] ? FCString::Atoi(*GSnapshot[static_cast<int32>(Variable)].OriginalValue) : 0;
+}
+
+
+EConsoleVariableFlags FSwitcherConsoleVariables::GetSetBy(ESwitcherCVar Variable) const
+{
+	const IConsoleVariable* CVar = Variables[static_cast<int32>(Variable)];
+	return CVar ? static_cast<EConsoleVariableFlags>(CVar->GetFlags() & ECVF_SetByMask) : ECVF_SetByConstructor;
+}
+
+
+void FSwitcherConsoleVariables::Queue(ESwitcherCVar Variable, int32 Value)
+{
+	const IConsoleVariable* CVar = Variables[static_cast<int32>(Variable)];
+	if (!CVar) return;
+	if (CVar->TestFlags(ECVF_ReadOnly))
+	{
+		UE_LOGFMT(LogLumenSwitcherCVars, Warning, "{0}: {1} is read only at runtime", __FUNCTION__, GetName(Variable));
+		return;
+	}
+	Pending.Emplace(Variable, Value);
+}
+
+
+/**
+ * SetByConsole is the highest priority, same as the console command used before - a change always takes effect.
+ * Unchanged values are skipped, so applying the same configuration repeatedly costs nothing.
+ */
+void FSwitcherConsoleVariables::ApplyPending()
+{
+	if (Pending.Num() == 0) return;
+	bool bChanged = false;
+	for (const TPair<ESwitcherCVar, int32>& Change : Pending)
+	{
+		IConsoleVariable* CVar = Variables[static_cast<int32>(Change.Key)];
+		if (CVar->GetInt() == Change.Value) continue;
+		CVar->Set(Change.Value, ECVF_SetByConsole);
+		FSnapshotEntry& Entry = GSnapshot[static_cast<int32>(Change.Key)];
+		Entry.bModified = true;
+		Entry.LastAppliedValue = Change.Value;
+		bChanged = true;
+	}
+	Pending.Reset();
+	if (bChanged)
+	{
+		IConsoleManager::Get().CallAllConsoleVariableSinks();
+	}
+}
+
+
+int32 FSwitcherConsoleVariables::ClearPending()
+{
+	const int32 NumDropped = Pending.Num();
+	Pending.Reset();
+	return NumDropped;
+}
+
+
+/**
+ * Only the last instance restores. The priority is lowered first, so the original value goes through a regular
+ * Set() with its original SetBy. Variables changed by someone else after our last change are left alone.
+ */
+void FSwitcherConsoleVariables::RestoreOriginalValues()
+{
+	Pending.Reset();
+	if (!bHoldsSnapshot) return;
+	bHoldsSnapshot = false;
+	if (--GSnapshotRefCount > 0) return;
+
+	bool bChanged = false;
+	for (int32 i = 0; i < static_cast<int32>(ESwitcherCVar::Num); i++)
+	{
+		IConsoleVariable* CVar = Variables[i];
+		FSnapshotEntry& Entry = GSnapshot[i];
+		if (!CVar || !Entry.bModified) continue;
+		Entry.bModified = false;
+		const EConsoleVariableFlags CurrentSetBy = static_cast<EConsoleVariableFlags>(CVar->GetFlags() & ECVF_SetByMask);
+		if (CurrentSetBy != ECVF_SetByConsole || CVar->GetInt() != Entry.LastAppliedValue)
+		{
+			UE_LOGFMT(LogLumenSwitcherCVars, Warning, "{0}: {1} was changed by another source ({2}), not restoring", __FUNCTION__, GetName(static_cast<ESwitcherCVar>(i)), GetConsoleVariableSetByName(CurrentSetBy));
+			continue;
+		}
+		CVar->SetFlags(static_cast<EConsoleVariableFlags>((CVar->GetFlags() & ~ECVF_SetByMask) | ECVF_SetByConstructor));
+		CVar->Set(*Entry.OriginalValue, Entry.OriginalSetBy);
+		bChanged = true;
+		UE_LOGFMT(LogLumenSwitcherCVars, Verbose, "{0}: {1} restored to {2} ({3})", __FUNCTION__, GetName(static_cast<ESwitcherCVar>(i)), Entry.OriginalValue, GetConsoleVariableSetByName(Entry.OriginalSetBy));
+	}
+	if (bChanged)
+	{
+		IConsoleManager::Get().CallAllConsoleVariableSinks();
+	}
+}
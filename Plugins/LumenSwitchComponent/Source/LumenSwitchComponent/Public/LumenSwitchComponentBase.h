@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/Scene.h"
+#include "Scalability.h"
+#include "LumenSwitcherConsoleVariables.h"
 
 #include "LumenSwitchComponentBase.generated.h"
 
@@ -26,6 +29,9 @@ class UInputMappingContext;
 //class USphereComponent;
 class UCameraComponent;
 class UCurveLinearColor;
+class USceneCaptureComponent2D;
+class ULocalPlayer;
+class FSceneViewFamily;
 
 
 /** Infos for Post Process Volumes in Level */
@@ -49,6 +55,176 @@ struct FPostProcessVolumeInfo
 	/** Is the Camera inside the PP Volume? Always true for infinite PP Volumes */
 	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
 	bool bCameraEncompassed = false;
+
+	/** Post Process Volume Blend Radius */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float BlendRadius = 0.f;
+
+	/** Post Process Volume Blend Weight */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float BlendWeight = 1.f;
+
+	/** World space Bounds without Blend Radius. Not valid for infinite PP Volumes */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	FBox Bounds = FBox(ForceInit);
+
+	/** Does the PP Volume override the GI Method? */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bOverridesGlobalIllumination = false;
+
+	/** GI Method set by the PP Volume, only relevant if overridden */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EDynamicGlobalIlluminationMethod::Type> GlobalIlluminationMethod = EDynamicGlobalIlluminationMethod::Lumen;
+
+	/** Does the PP Volume override the Reflection Method? */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bOverridesReflections = false;
+
+	/** Reflection Method set by the PP Volume, only relevant if overridden */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EReflectionMethod::Type> ReflectionMethod = EReflectionMethod::Lumen;
+};
+
+
+/** One combination of the rendering paths the Switcher can toggle to */
+USTRUCT(BlueprintType)
+struct FSwitcherRenderConfiguration
+{
+	GENERATED_BODY()
+
+	/** Dynamic Global Illumination Method */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EDynamicGlobalIlluminationMethod::Type> GlobalIlluminationMethod = EDynamicGlobalIlluminationMethod::Lumen;
+
+	/** Reflection Method */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EReflectionMethod::Type> ReflectionMethod = EReflectionMethod::Lumen;
+
+	/** Lumen Use Hardware Ray Tracing */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bHardwareRayTracing = false;
+};
+
+
+/** Upscaler / anti-aliasing mode for the matrix sweep, values match r.AntiAliasingMethod */
+UENUM(BlueprintType)
+enum class ESwitcherUpscalerMode : uint8
+{
+	None = 0	UMETA(DisplayName = "None (Spatial)"),
+	TAA = 2		UMETA(DisplayName = "TAA"),
+	TSR = 4		UMETA(DisplayName = "TSR")
+};
+
+
+/** Measured frame times for one cell of the matrix sweep */
+USTRUCT(BlueprintType)
+struct FSwitcherMatrixCell
+{
+	GENERATED_BODY()
+
+	/** GI / Reflection / HWRT configuration */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	FSwitcherRenderConfiguration Configuration;
+
+	/** Single scalability level applied to all sg.* groups */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	int32 ScalabilityLevel = 3;
+
+	/** Configuration as it took effect - scalability levels below High disable Lumen, Low disables SSGI / SSR */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	FSwitcherRenderConfiguration EffectiveConfiguration;
+
+	/** Requested internal resolution as screen percentage */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float ScreenPercentage = 100.f;
+
+	/** Screen percentage as it took effect, differs if r.ScreenPercentage is held at a higher priority */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float EffectiveScreenPercentage = 100.f;
+
+	/** Requested configuration and screen percentage are both in effect */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bRequestedSettingsActive = true;
+
+	/** Upscaler mode */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	ESwitcherUpscalerMode UpscalerMode = ESwitcherUpscalerMode::TSR;
+
+	/** Number of frames sampled */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	int32 SampleCount = 0;
+
+	/** Sampling started with compiles still pending, percentiles may include compilation */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bCompileTimedOut = false;
+
+	/** Frame time percentiles in milliseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float FrameTimeP50 = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float FrameTimeP90 = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float FrameTimeP99 = 0.f;
+
+	/** GPU frame time percentiles in milliseconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float GPUTimeP50 = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float GPUTimeP90 = 0.f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float GPUTimeP99 = 0.f;
+};
+
+
+/** Effective state of a single view - local player or registered scene capture */
+USTRUCT(BlueprintType)
+struct FSwitcherViewInfo
+{
+	GENERATED_BODY()
+
+	/** Local Player or Scene Capture name */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	FName ViewName;
+
+	/** Is this a registered Scene Capture instead of a Local Player view? */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	bool bIsSceneCapture = false;
+
+	/** View Location used for the encompass checks */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	FVector ViewLocation = FVector::ZeroVector;
+
+	/** Effective GI Method for this view */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EDynamicGlobalIlluminationMethod::Type> GlobalIlluminationMethod = EDynamicGlobalIlluminationMethod::None;
+
+	/** Effective Reflection Method for this view */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TEnumAsByte<EReflectionMethod::Type> ReflectionMethod = EReflectionMethod::None;
+
+	/** Post Process Volumes encompassing the view, ascending priority */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	TArray<FName> EncompassingVolumes;
+
+	/** Estimated share of the frame cost, based on internally rendered pixels (player views scaled by the static or dynamic resolution fraction) */
+	UPROPERTY(BlueprintReadOnly, Category = "Switcher")
+	float FrameCostShare = 0.f;
+};
+
+
+/** Phases of the time sliced initialization started at BeginPlay */
+UENUM(BlueprintType)
+enum class ESwitcherInitPhase : uint8
+{
+	ResolveSettings		UMETA(DisplayName = "Resolve Settings"),
+	DiscoverVolumes		UMETA(DisplayName = "Discover Volumes"),
+	EvaluateEncompass	UMETA(DisplayName = "Evaluate Encompass"),
+	GenerateLines		UMETA(DisplayName = "Generate Lines"),
+	Done				UMETA(DisplayName = "Done")
 };
 
 
@@ -62,9 +238,13 @@ public:
 	ULumenSwitchComponentBase();
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	/** Collect the Infos for a single Post Process Volume, camera encompass state is left untouched */
+	static FPostProcessVolumeInfo MakePostProcessVolumeInfo(const APostProcessVolume* PPVol);
+
 protected:
 
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	/** 
 	 * Toggle the Override of Post Process settings 
@@ -77,7 +257,7 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "OverrideEnabled"))
 	bool IsOverrideEnabled() const;
 
-	/** Get the Value for Lumen "Use Hardware Ray Tracing When Available" from Project settings */
+	/** Get the Value for Lumen "Use Hardware Ray Tracing When Available" at BeginPlay, including runtime overrides */
 	UFUNCTION(BlueprintCallable, Category = "Switcher")
 	bool GetDefaultLumen_HardwareRayTracing();
 
@@ -89,10 +269,41 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "UseHWRaytracing"))
 	bool ToggleLumenHardwareRayTracing();
 
-	/** Get the effective Post Process Settings for the current View */
+	/** Get the live value of a Lumen / ray tracing cvar and the source that did set it */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Console Variables", meta = (ReturnDisplayName = "Value"))
+	int32 GetConsoleVariable(ESwitcherCVar Variable, FString& SetBy) const;
+
+	/** Queue a cvar change, applied together with other queued changes by ApplyConsoleVariables. Rejected during warm-up and matrix sweep */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Console Variables", meta = (ReturnDisplayName = "Queued"))
+	bool QueueConsoleVariable(ESwitcherCVar Variable, int32 Value);
+
+	/** Apply all queued cvar changes in one step. During warm-up and matrix sweep, queued changes are dropped. Original values get restored at EndPlay */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Console Variables", meta = (ReturnDisplayName = "Applied"))
+	bool ApplyConsoleVariables();
+
+	/** Get the effective Post Process Settings for the current View of the owning Local Player */
 	UFUNCTION(BlueprintCallable, Category = "Switcher")
 	void GetCurrentPostProcessSettings(FPostProcessSettings& OutPPSettings) const;
 
+	/** 
+	 * Evaluate all Local Player views and registered Scene Captures in one batched query: one view family
+	 * for all Local Players and one pass over the Post Process Volumes for all view locations.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Views")
+	void EvaluateViews();
+
+	/** Get the view infos from the most recent evaluation */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Views")
+	void GetViewInfos(TArray<FSwitcherViewInfo>& OutViewInfos) const;
+
+	/** Include a Scene Capture in the view evaluation */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Views")
+	void RegisterSceneCapture(USceneCaptureComponent2D* SceneCapture);
+
+	/** Remove a Scene Capture from the view evaluation */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Views")
+	void UnregisterSceneCapture(USceneCaptureComponent2D* SceneCapture);
+
 	/** Get the owning Actors Camera Post Process Settings */
 	UFUNCTION(BlueprintCallable, Category = "Switcher")
 	void GetCameraPostProcessSettings(FPostProcessSettings& CameraPPSettings) const;
@@ -114,6 +325,48 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "MaxPriority"))
 	float GetPostProcessVolumesInLevel(TMap<FName, FPostProcessVolumeInfo>& PPVolMap, bool bDebug = false);
 
+	/** Has the time sliced initialization started at BeginPlay completed? */
+	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "Initialized"))
+	bool IsInitialized() const;
+
+	/** Progress of the time sliced initialization in range 0..1 */
+	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "Progress"))
+	float GetInitializationProgress() const;
+
+	/** 
+	 * Cycle through all switchable GI / Reflection / HWRT configurations to get pipeline states compiled
+	 * before doing any comparisons. Settings are restored afterwards.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Switcher")
+	void StartPipelineWarmUp();
+
+	/** Is the pipeline state warm-up currently running? Toggles are ignored meanwhile */
+	UFUNCTION(BlueprintCallable, Category = "Switcher", meta = (ReturnDisplayName = "WarmingUp"))
+	bool IsWarmingUp() const;
+
+	/** 
+	 * Measure frame time percentiles for each switchable configuration at each scalability level,
+	 * screen percentage and upscaler mode. Results are written to Saved/LumenSwitcher as CSV.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Matrix")
+	void StartMatrixSweep();
+
+	/** Stop a running matrix sweep and restore the settings */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Matrix")
+	void CancelMatrixSweep();
+
+	/** Is the matrix sweep currently running? Toggles are ignored meanwhile */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Matrix", meta = (ReturnDisplayName = "Active"))
+	bool IsMatrixSweepActive() const;
+
+	/** Get the matrix cells, measured so far or from the last sweep */
+	UFUNCTION(BlueprintCallable, Category = "Switcher|Matrix")
+	void GetMatrixResults(TArray<FSwitcherMatrixCell>& OutCells) const;
+
+	/** Get all configurations the Switcher can toggle to (not considering "Plugin" GI method), HWRT variants only with Lumen and if ray tracing is enabled */
+	UFUNCTION(BlueprintCallable, Category = "Switcher")
+	void GetSwitchableConfigurations(TArray<FSwitcherRenderConfiguration>& OutConfigurations) const;
+
 	/** Check if Camera is inside a given PP Volume */
 	UFUNCTION(BlueprintCallable, Category = "Switcher")
 	bool IsCameraInside(APostProcessVolume* PPVolume) const;
@@ -144,6 +397,62 @@ protected:
 		meta = (Units = "Seconds", Delta = 0.1f))
 	float FPSRefreshRate = 0.3;
 
+	/** 
+	 * Time Budget per Frame for the initialization started at BeginPlay. Volume discovery, encompass
+	 * evaluation and visualization line generation are spread over multiple frames to avoid a hitch.
+	 */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Switcher",
+		meta = (ClampMin = "0.1", UIMin = "0.1", ClampMax = "16.0", UIMax = "4.0"),
+		meta = (Units = "Milliseconds", Delta = 0.1f))
+	float InitFrameBudget = 1.f;
+
+	/** Evaluate all Local Player views and registered Scene Captures each frame (split-screen, captures) */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Views")
+	bool bEvaluateAllViews = false;
+
+	/** Cycle all switchable configurations once initialization is complete, so that later toggles measure steady state cost */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Warm-Up", meta = (DisplayName = "Warm-Up Pipeline States at Start"))
+	bool bWarmUpPipelineStates = false;
+
+	/** Minimum number of frames each configuration is rendered during warm-up */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Warm-Up", 
+		meta = (EditCondition = "bWarmUpPipelineStates", EditConditionHides, ClampMin = "1", UIMin = "1", UIMax = "30"))
+	int32 WarmUpFramesPerConfiguration = 3;
+
+	/** Give up waiting for pending pipeline and shader compiles after this time */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Warm-Up", 
+		meta = (EditCondition = "bWarmUpPipelineStates", EditConditionHides, ClampMin = "1.0", UIMin = "1.0", UIMax = "300.0"),
+		meta = (Units = "Seconds"))
+	float WarmUpTimeout = 60.f;
+
+	/** Run the matrix sweep once initialization (and warm-up, if enabled) is complete */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (DisplayName = "Run Matrix Sweep at Start"))
+	bool bRunMatrixSweepAtStart = false;
+
+	/** Scalability levels to sweep, applied to all sg.* groups (0 = Low ... 3 = Epic, 4 = Cinematic) */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (ClampMin = "0", ClampMax = "4"))
+	TArray<int32> MatrixScalabilityLevels = { 0, 1, 2, 3 };
+
+	/** Internal resolutions to sweep as screen percentage, scalability limits these to 100 */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (ClampMin = "25.0", ClampMax = "100.0"))
+	TArray<float> MatrixScreenPercentages = { 50.f, 75.f, 100.f };
+
+	/** Upscaler modes to sweep */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix")
+	TArray<ESwitcherUpscalerMode> MatrixUpscalerModes = { ESwitcherUpscalerMode::TSR };
+
+	/** Give up waiting for pending pipeline and shader compiles of a cell after this time */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (ClampMin = "1.0", UIMax = "120.0", Units = "Seconds"))
+	float MatrixCompileTimeout = 30.f;
+
+	/** Frames to skip after pending compiles of a cell are done, before sampling starts */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (ClampMin = "0", UIMax = "120"))
+	int32 MatrixSettleFrames = 30;
+
+	/** Frames to sample for each cell */
+	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Matrix", meta = (ClampMin = "1", UIMax = "600"))
+	int32 MatrixSampleFrames = 120;
+
 	/** Should we Visualize the Post Process Volumes found in Level? */
 	UPROPERTY(EditDefaultsOnly, Category = "Switcher|Post Process Volumes")
 	bool bVisualizePPVolBounds = false;
@@ -173,9 +482,24 @@ protected:
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnUpdateUI(float FPS);
 
+	/** Progress of the time sliced initialization, called for each frame until complete */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInitializationProgress(float Progress, bool bComplete);
+
+	/** Pipeline state warm-up finished, settings have been restored */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnPipelineWarmUpFinished(float Seconds, bool bTimedOut);
+
+	/** A matrix cell has been measured */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnMatrixCellMeasured(const FSwitcherMatrixCell& Cell);
+
+	/** Matrix sweep finished or cancelled, settings have been restored */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnMatrixSweepFinished(bool bCancelled);
+
 private:
 
-	bool bLumenUseHardwareRayTracing = false;
 	int32 ReflectionCaptureResolution = 128;
 	int32 FrameCount = 0;
 	float AccuTime = 0;
@@ -185,11 +509,68 @@ private:
 	UPROPERTY()
 	TObjectPtr<UCameraComponent> PlayerCameraComponent;
 
+	/** Cached handles for the Lumen and ray tracing cvars */
+	FSwitcherConsoleVariables ConsoleVariables;
+
 	UPROPERTY()
 	TMap<FName, FPostProcessVolumeInfo> PPVolumesInLevel;
 
+	/** Time sliced initialization state */
+	ESwitcherInitPhase InitPhase = ESwitcherInitPhase::Done;
+	int32 InitCursor = 0;
+	TArray<TWeakObjectPtr<APostProcessVolume>> InitPPVols;
+	TArray<FName> InitPPVolNames;
+
+	/** Multi view evaluation */
+	TArray<TWeakObjectPtr<USceneCaptureComponent2D>> RegisteredSceneCaptures;
+	TArray<FSwitcherViewInfo> ViewInfos;
+
+	/** Pipeline state warm-up state */
+	bool bWarmUpActive = false;
+	int32 WarmUpIndex = 0;
+	int32 WarmUpFramesHeld = 0;
+	double WarmUpStartTime = 0.0;
+	TArray<FSwitcherRenderConfiguration> WarmUpConfigurations;
+
+	/** Matrix sweep state */
+	bool bMatrixActive = false;
+	bool bMatrixSweepPending = false;
+	int32 MatrixCellIndex = 0;
+	int32 MatrixFrame = 0;
+	bool bMatrixCellApplied = false;
+	bool bMatrixCompilesDone = false;
+	double MatrixCellStartTime = 0.0;
+	double MatrixLastStepTime = 0.0;
+	TArray<FSwitcherMatrixCell> MatrixCells;
+	TArray<float> MatrixFrameTimes;
+	TArray<float> MatrixGPUTimes;
+	Scalability::FQualityLevels SavedQualityLevels;
+	int32 SavedAntiAliasingMethod = static_cast<int32>(ESwitcherUpscalerMode::TSR);
+
+	/** Settings to restore after warm-up or matrix sweep */
+	FSwitcherRenderConfiguration SavedRenderConfiguration;
+	bool bSavedOverrideGI = false;
+	bool bSavedOverrideReflections = false;
+
+	void StepInitialization();
+	void AdvanceInitialization();
+	void ResolveInitialSettings();
+	void StepPipelineWarmUp();
+	void FinishPipelineWarmUp(bool bTimedOut);
+	void StepMatrixSweep();
+	void ApplyMatrixCell(FSwitcherMatrixCell& Cell);
+	void FinishMatrixSweep(bool bCancelled);
+	void WriteMatrixReport() const;
+	void SaveRenderConfiguration();
+	void RestoreRenderConfiguration();
+	bool IsSwitchingLocked() const;
+	void ApplyRenderConfiguration(const FSwitcherRenderConfiguration& Configuration);
+	int32 GetNumPendingPipelineCompiles() const;
+	void SetLumenHardwareRayTracing(bool bEnable);
 	void SetupEnhancedInput();
-	void VisualizePostprocessVolumesInLevel(float LifeTime = -1.f);
+	ULocalPlayer* GetOwnerLocalPlayer() const;
+	float GetPlayerResolutionFraction(const FSceneViewFamily& ViewFamily) const;
+	bool GetVisualizationColor(const APostProcessVolume* PPVol, FColor& OutColor) const;
 	void VisualizePPVol(APostProcessVolume* PPVol, const FColor& Color, float LifeTime = -1.f, float Thickness = 0.f);
 	//void AddPostProcessComponentToOwnerCharacter(float Priority);
 };
@@ -0,0 +1,33 @@
+// Copyright Herbert Mehlhose, Herb64, 2025
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "LumenSwitcherAuditCommandlet.generated.h"
+
+/**
+ * Offline audit of the Post Process Volumes in all maps, without opening each one in PIE.
+ * Collects the same volume data as FPostProcessVolumeInfo plus the Lumen quality overrides,
+ * flags likely expensive or conflicting setups and writes one consolidated CSV report.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd.exe <Project>.uproject -run=LumenSwitcherAudit [-Maps=/Game/Path] [-BatchSize=8] [-Output=File.csv]
+ *
+ * Remarks:
+ * 1. Maps of a batch are requested together from the async loader and then evaluated one by one on the game
+ *    thread, worlds can not be initialized in parallel. Garbage is collected after each batch.
+ * 2. For World Partition maps, only actors loaded with the persistent level are covered.
+ * 3. Returns non-zero if the report could not be written or any map failed to load.
+ */
+UCLASS()
+class LUMENSWITCHCOMPONENT_API ULumenSwitcherAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	ULumenSwitcherAuditCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
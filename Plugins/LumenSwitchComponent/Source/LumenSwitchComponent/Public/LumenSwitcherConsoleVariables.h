@@ -0,0 +1,78 @@
+// Copyright Herbert Mehlhose, Herb64, 2025
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+
+#include "LumenSwitcherConsoleVariables.generated.h"
+
+/** Console variables handled by the Switcher control layer */
+UENUM(BlueprintType)
+enum class ESwitcherCVar : uint8
+{
+	LumenHardwareRayTracing			UMETA(DisplayName = "r.Lumen.HardwareRayTracing"),
+	LumenHardwareRayTracingLighting	UMETA(DisplayName = "r.Lumen.HardwareRayTracing.LightingMode"),
+	LumenDiffuseIndirectAllow		UMETA(DisplayName = "r.Lumen.DiffuseIndirect.Allow"),
+	LumenReflectionsAllow			UMETA(DisplayName = "r.Lumen.Reflections.Allow"),
+	RayTracing						UMETA(DisplayName = "r.RayTracing"),
+	DynamicGlobalIlluminationMethod	UMETA(DisplayName = "r.DynamicGlobalIlluminationMethod"),
+	ReflectionMethod				UMETA(DisplayName = "r.ReflectionMethod"),
+	AntiAliasingMethod				UMETA(DisplayName = "r.AntiAliasingMethod"),
+	ScreenPercentage				UMETA(DisplayName = "r.ScreenPercentage"),
+	SSGIQuality						UMETA(DisplayName = "r.SSGI.Quality"),
+	SSRQuality						UMETA(DisplayName = "r.SSR.Quality"),
+	Num								UMETA(Hidden)
+};
+
+
+/**
+ * Cached console variable handles for the Lumen and ray tracing cvars.
+ * 1. Handles are resolved once, reads go to the live value - so overrides from device profiles, command line
+ *    or other tools are seen, unlike reading the project settings from GConfig.
+ * 2. Changes are queued and applied together by ApplyPending() on the game thread. Render thread safe cvars
+ *    push their shadow values with ordered render commands, so the render thread sees the whole batch at once.
+ * 3. The original values and their priority (SetBy) are a snapshot shared by all instances and ref counted,
+ *    so a second Switcher (split-screen) does not take an already modified value as original. The last
+ *    instance calling RestoreOriginalValues() brings both back, so nothing leaks into the next PIE session.
+ */
+class LUMENSWITCHCOMPONENT_API FSwitcherConsoleVariables
+{
+public:
+
+	~FSwitcherConsoleVariables();
+
+	/** Resolve the handles and take or share the snapshot of the original values */
+	void Initialize();
+
+	/** Get the live value, 0 if the cvar does not exist in this build */
+	int32 GetInt(ESwitcherCVar Variable) const;
+	bool GetBool(ESwitcherCVar Variable) const;
+	float GetFloat(ESwitcherCVar Variable) const;
+
+	/** Get the value from the snapshot taken by the first initialized instance */
+	int32 GetOriginalInt(ESwitcherCVar Variable) const;
+
+	/** Get the priority source of the live value */
+	EConsoleVariableFlags GetSetBy(ESwitcherCVar Variable) const;
+
+	/** Queue a change, applied with the next ApplyPending() */
+	void Queue(ESwitcherCVar Variable, int32 Value);
+
+	/** Apply all queued changes in one step */
+	void ApplyPending();
+
+	/** Drop all queued changes, returns the number of dropped changes */
+	int32 ClearPending();
+
+	/** Release the snapshot, the last instance restores values and priorities of all changed variables */
+	void RestoreOriginalValues();
+
+	static const TCHAR* GetName(ESwitcherCVar Variable);
+
+private:
+
+	IConsoleVariable* Variables[static_cast<int32>(ESwitcherCVar::Num)] = {};
+	TArray<TPair<ESwitcherCVar, int32>> Pending;
+	bool bHoldsSnapshot = false;
+};